@@ -0,0 +1,39 @@
+# QOLDS initialization data
+#
+# Converts resources/initIrreducibleGF3.dat (one line per dimension: d, s, a, m_1 .. m_s)
+# into a header defining QOLDS_INIT_DATA, the initializer of the qolds::InitRow table of
+# src/qolds_matrices.hpp, so the generator matrices are computed at compile time.
+
+function(qolds_generate_init_data INPUT OUTPUT)
+    file(STRINGS ${INPUT} _lines)
+
+    set(_rows "")
+    set(_count 0)
+    foreach(_line IN LISTS _lines)
+        # Skip the header (d s a m_i) and empty lines
+        string(STRIP "${_line}" _line)
+        if(_line STREQUAL "" OR _line MATCHES "^d")
+            continue()
+        endif()
+
+        string(REGEX REPLACE "[ \t]+" ";" _values "${_line}")
+        list(POP_FRONT _values _d _s _a)
+        list(JOIN _values ", " _mk)
+        string(APPEND _rows "    {${_d}, ${_s}, ${_a}, {${_mk}}}, \\\n")
+        math(EXPR _count "${_count} + 1")
+    endforeach()
+
+    get_filename_component(_input_name ${INPUT} NAME)
+    set(_content "// Generated by cmake/qolds_init_data.cmake from ${_input_name}, do not edit\n")
+    string(APPEND _content "#pragma once\n\n")
+    string(APPEND _content "#define QOLDS_INIT_DIMENSIONS ${_count}\n\n")
+    string(APPEND _content "// {d, s, a, {m_1 .. m_s}} per dimension\n")
+    string(APPEND _content "#define QOLDS_INIT_DATA \\\n${_rows}\n")
+
+    # Only touch the header when the data changed, to avoid rebuilding
+    file(CONFIGURE OUTPUT ${OUTPUT} CONTENT "${_content}")
+
+    # Regenerate when the data file is edited
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${INPUT})
+    message(STATUS "QOLDS: ${_count} dimensions from ${_input_name} -> ${OUTPUT}")
+endfunction()
@@ -29,6 +29,7 @@ NAMESPACE_SHADERIO_BEGIN()
 
 #define WORKGROUP_SIZE 16
 #define SILHOUETTE_WORKGROUP_SIZE 16
+#define WAVEFRONT_WORKGROUP_SIZE 128  // 1D kernels of the wavefront path tracer, one thread per queue entry
 
 
 #define HDR_DIFFUSE_INDEX 0
@@ -66,6 +67,283 @@ enum BindingPoints
   eTexturesStorage,
   eQoldsMatrices, // QOLDS generator matrices
   eQoldsSeeds,    // QOLDS Owen scrambling seeds
+  eQoldsTable,    // QOLDS precomputed point table
+  eQoldsScrambleTree,  // QOLDS precomputed Owen scramble tree levels
+  eSobolMatrices,      // Sobol' direction numbers
+  eWavefrontCounters,  // Wavefront path tracer: queue counters, indirect arguments and material counts
+  eAdaptiveErrorSums,  // Adaptive sampling: tile error sums of the last two frames
+  ePathtraceCounters,  // Path tracer: persistent-threads work counter and lane statistics
+  eLightAlias,         // Alias table of the light selection, over the power of the lights
+  eLightTree,          // Light BVH over the point and spot lights, then the directional lights
+  eEmissiveTriangles,  // Emissive triangles of the next-event estimation, with their alias table
+  eEmissiveNodes,      // First emissive triangle of every render node, -1 without emission
+};
+
+// Dimensions of a path sample (path_sampler.h.slang): the camera ones, then one block per bounce,
+// both whole groups of SOBOL_GROUP_DIMENSIONS
+#define SAMPLER_CAMERA_DIMENSIONS 4
+#define SAMPLER_BOUNCE_DIMENSIONS 12
+
+// Sobol' dimensions evaluated per group of path dimensions (SOBOL_MAX_DIMENSIONS in sobol_builder.hpp)
+#define SOBOL_GROUP_DIMENSIONS 4
+
+// Sampler of the path tracer, specialization constant SAMPLER_TYPE of gltf_pathtrace.slang
+enum SamplerType
+{
+  eSamplerPcg = 0,    // Independent PCG random numbers
+  eSamplerQolds,      // Base-3 QOLDS with Owen scrambling (QoldsMode)
+  eSamplerSobolOwen,  // Base-2 Sobol' with hash-based Owen scrambling
+};
+
+// QOLDS evaluation modes
+enum QoldsMode
+{
+  eQoldsAnalytic = 0,  // Generator matrices and Owen scrambling for every sample
+  eQoldsTableFloat,    // Precomputed scrambled point table (float32)
+  eQoldsTableUnorm16,  // Precomputed scrambled point table (16-bit unorm)
+};
+
+// Kernels between which the single-thread wfPrepareMain runs (pushConst.wavefrontStage)
+enum WavefrontStage
+{
+  eWavefrontExtend = 0,  // Rotate the ray queues and reset the counters, arguments of wfExtendMain
+  eWavefrontShade,       // Prefix sum of the material counts, arguments of wfSortMain and wfShadeMain
+  eWavefrontConnect,     // Arguments of wfConnectMain
+};
+
+// Layout of the wavefront counter buffer (eWavefrontCounters), in uints
+#define WAVEFRONT_RAY_COUNT 0       // Rays of the current bounce
+#define WAVEFRONT_NEXT_RAY_COUNT 1  // Rays appended for the next bounce
+#define WAVEFRONT_HIT_COUNT 2       // Hits appended by wfExtendMain
+#define WAVEFRONT_SHADOW_COUNT 3    // Shadow rays appended by wfShadeMain
+#define WAVEFRONT_EXTEND_ARGS 4     // VkDispatchIndirectCommand of wfExtendMain
+#define WAVEFRONT_SHADE_ARGS 8      // VkDispatchIndirectCommand of wfSortMain and wfShadeMain
+#define WAVEFRONT_CONNECT_ARGS 12   // VkDispatchIndirectCommand of wfConnectMain
+#define WAVEFRONT_KEY_COUNTS 16     // Hits per material key, then the scatter cursor of every key
+
+#define WAVEFRONT_PLANE_INSTANCE 0xFFFFFFFF  // Instance of a hit on the infinite plane
+
+// Layout of the path tracer counter buffer (ePathtraceCounters), in uints, cleared every frame
+#define PATHTRACE_WORK_COUNTER 0  // Persistent threads: next work item (pixel of the slice, in tile order)
+#define PATHTRACE_ACTIVE_LANES 1  // Lane statistics: active lanes at every bounce, summed over the waves
+#define PATHTRACE_WAVE_LANES 2    // Lane statistics: lanes of those waves
+#define PATHTRACE_LIGHT_STATS 4   // Light statistics: contribution of every LightTechnique, 64-bit fixed point (low, high uints)
+#define PATHTRACE_COUNTERS 10
+
+// Light statistics: the light samples of the first frames of a render measure the contribution of
+// every technique of sampleLights(), from which the host learns the selection probabilities
+#define LIGHT_STATS_FRAMES 16            // Frames of a render recording the statistics
+#define LIGHT_STATS_FIXED_POINT 1024.0f  // Scale of the luminance summed with integer atomics
+
+// Light selection technique of a light sample (PATHTRACE_LIGHT_STATS)
+enum LightTechnique
+{
+  eLightTechniqueEnvironment,
+  eLightTechniquePunctual,
+  eLightTechniqueEmissive,
+  eLightTechniqueCount
+};
+
+// Queues of the wavefront path tracer, structures of arrays in device memory
+struct WavefrontQueues
+{
+  // Path state, one per pixel
+  float4* pathOrigin;        // xyz: origin of the next ray
+  float4* pathDirection;     // xyz: direction of the next ray, w: pdf of the BSDF sample (DIRAC for camera rays)
+  float4* pathThroughput;    // rgb: throughput
+  float4* pathRadiance;      // rgb: radiance, a: 1 if the camera ray hit a surface
+  float2* pathMaxRoughness;  // Largest roughness along the path
+  uint*   pathFlags;         // 1: the path is inside a volume
+  uint*   pathSeed;          // PCG state of the PathSampler
+
+  // Rays to trace (path indices), alternating between bounces
+  uint* rayQueue0;
+  uint* rayQueue1;
+
+  // Compacted hits
+  uint*   hitPath;
+  uint*   hitInstance;   // Render node, WAVEFRONT_PLANE_INSTANCE for the infinite plane
+  uint*   hitPrimitive;  // Render primitive
+  uint*   hitTriangle;
+  float2* hitBarycentrics;
+  float*  hitT;
+  uint*   hitKey;     // Material of the hit, numKeys - 1 for the infinite plane
+  uint*   hitSorted;  // Hit indices sorted by key
+
+  // Shadow rays
+  uint*   shadowPath;
+  float4* shadowOrigin;        // xyz: origin, w: distance to the light
+  float4* shadowDirection;     // xyz: direction to the light
+  float4* shadowContribution;  // rgb: unoccluded contribution of the light, a: LightTechnique of the sample
+
+  uint numPaths;  // Pixels of the render
+  uint numKeys;   // Materials of the scene, plus the infinite plane
+};
+
+// Per-pixel adaptive sampling (adaptive_sampling.h.slang), in tiles of WORKGROUP_SIZE x WORKGROUP_SIZE pixels
+#define ADAPTIVE_MAX_SAMPLE_SCALE 4            // A tile takes at most this many times numSamples in a frame
+#define ADAPTIVE_MAX_ERROR 16.0f               // Relative error of a pixel with fewer than two samples
+#define ADAPTIVE_ERROR_FIXED_POINT 1024.0f     // Scale of the tile errors summed with integer atomics
+#define ADAPTIVE_ERROR_SUMS 4                  // uints of eAdaptiveErrorSums: (error sum, active tiles) per frame parity
+
+// Per-pixel adaptive sampling state, updated every frame
+struct AdaptiveSampling
+{
+  float4* pixelStats;   // Welford statistics of the sample luminance: mean, M2, sample count, relative error of the mean
+  uint*   tileSamples;  // Samples of every tile in the next frame, 0 once all its pixels converged
+  uint    tilesX;       // Tiles in a row of the image
+  int     enabled;      // 0: every pixel takes numSamples, as without adaptive sampling
+  float   threshold;    // Relative error of the mean under which a pixel stops being traced
+  int     minSamples;   // Samples a pixel takes before it may stop
+};
+
+// ReSTIR DI (restir_di.h.slang): light of a reservoir sample
+enum RestirLight
+{
+  eRestirNone = 0,     // Empty reservoir
+  eRestirPunctual,     // Punctual light: light index, uv of singleLightContribution()
+  eRestirEmissive,     // Emissive triangle: triangle index, uv of the point on the triangle
+  eRestirEnvironment,  // Environment: octahedral uv of the direction
+};
+
+// ReSTIR DI reservoir of a pixel: the light sample it kept, and its weights
+struct RestirReservoir
+{
+  int    lightType;   // RestirLight
+  int    lightIndex;  // Punctual light or emissive triangle
+  float2 lightUv;     // Point on the light, or direction of the environment
+  float  weightSum;   // Sum of the resampling weights of the candidates
+  float  M;           // Candidates behind the reservoir
+  float  W;           // Contribution weight of the sample: weightSum / (M * targetPdf), 0 when occluded
+  float  targetPdf;   // Target function of the sample at the surface of the pixel
+};
+
+// ReSTIR DI primary surface of a pixel, for the similarity of the reused neighbors
+struct RestirSurface
+{
+  float3 position;
+  float  viewDepth;  // Distance to the camera, 0 when the camera ray hit nothing
+  float3 normal;
+  int    _pad0;
+};
+
+// ReSTIR DI state, updated every frame
+struct RestirState
+{
+  RestirReservoir* reservoirs;      // Reservoirs of the candidates, then the final ones (the history of the next frame)
+  RestirSurface*   surfaces;        // Primary surfaces of the last two frames, by frame parity
+  int              enabled;         // 0: the primary hits use sampleLights() as the others
+  int              candidates;      // Light samples streamed into the reservoir of a pixel
+  int              temporal;        // 1: reuse the reservoir of the previous frame
+  int              spatialSamples;  // Neighbors reused
+  float            spatialRadius;   // Pixels around the pixel where the neighbors are picked
+  int              historyValid;    // 0: the reservoirs of the previous frame are not there
+  uint             frame;           // Frame counter: parity of the surfaces, seed of the candidates
+  int              _pad0;
+};
+
+// Path guiding (path_guiding.h.slang): an SD-tree learned from the radiance of the paths, built on the
+// host by GuidingTreeBuilder (guiding_tree_builder.hpp)
+#define GUIDING_PATH_VERTICES 4         // First vertices of a path recording their incident radiance
+#define GUIDING_MAX_RECORDS (1 << 20)   // Records of an iteration, the recording paths are drawn to fit
+#define GUIDING_MAX_DEPTH 20            // Levels of a directional quadtree
+#define GUIDING_BSDF_FRACTION 0.5f      // Probability of sampling the BSDF rather than the learned distribution
+#define GUIDING_MIN_ROUGHNESS 0.05f     // Smoother surfaces only sample their BSDF
+
+// Node of the spatial binary tree, over the box of the scene: a node halves its box along its axis
+struct GuidingSpatialNode
+{
+  int child;  // First of the two children, 0 for a leaf
+  int axis;   // Axis halved by the node, the next one for its children
+  int dtree;  // Leaf: root of its directional quadtree, -1 when it has learned nothing
+  int _pad0;
+};
+
+// Node of a directional quadtree, over the cylindrical coordinates ((cos theta + 1) / 2, phi / 2pi) of the
+// sphere: quadrant x + 2y of the square of the node
+struct GuidingDirectionalNode
+{
+  float4 sums;      // Radiance reaching the quadrants
+  int4   children;  // Node of every quadrant, 0 for a leaf
+};
+
+// Incident radiance of a path vertex in the direction it sampled
+struct GuidingRecord
+{
+  float3 position;
+  float  radiance;  // Luminance of the radiance
+  float3 direction;
+  float  pdf;  // Probability of the direction, in solid angle
+};
+
+// Path guiding state, updated every frame
+struct GuidingState
+{
+  GuidingSpatialNode*     spatialNodes;
+  GuidingDirectionalNode* directionalNodes;  // Quadtrees of all spatial leaves
+  GuidingRecord*          records;           // Records of the current iteration
+  uint*                   recordCount;       // Records appended, past GUIDING_MAX_RECORDS they are dropped
+  float3                  boundsMin;         // Box of the spatial tree
+  int                     enabled;           // 1: sample the learned distribution, once an iteration is done
+  float3                  boundsSize;
+  float                   recordProbability;  // Probability of a path recording its vertices, 0 when not learning
+};
+
+// State of the path tracer that changes every frame but does not fit in the push constant
+struct PathtraceFrameState
+{
+  AdaptiveSampling adaptive;           // Per-pixel adaptive sampling
+  RestirState      restir;             // ReSTIR DI of the primary hits
+  GuidingState     guiding;            // Path guiding of the BSDF samples
+  int2             sliceOffset;        // First pixel of the image slice rendered in this frame (time slicing)
+  int2             sliceSize;          // Pixels of the image slice
+  float4*          splitPartials;      // Sample split: radiance sums, then adaptive statistics, of every split of every pixel
+  int              sampleSplit;        // Threads sharing the samples of a pixel (grid Z), 1 when off
+  int              lightTree;          // 1: sample the lights with the light BVH, 0: with the alias table over their power
+  int              lightTreeNodes;     // Light BVH: nodes of the tree over the point and spot lights
+  int              lightTreeInfinite;  // Light BVH: directional lights, leaves stored after the tree
+  int              emissiveTriangles;  // Emissive triangles of the next-event estimation
+  int              lightStats;         // 1: sum the contribution of every light technique (PATHTRACE_LIGHT_STATS)
+};
+
+// Entry of the alias table selecting a light in proportion to its power (eLightAlias, light_alias_builder.hpp)
+struct LightAliasEntry
+{
+  float prob;      // Probability of keeping this light, otherwise the alias is selected
+  int   alias;     // Light taking the rest of the entry
+  float pdf;       // Probability of selecting this light
+  float aliasPdf;  // Probability of selecting the alias, saves a second fetch
+};
+
+// Node of the light BVH (eLightTree, light_tree_builder.hpp), in depth-first order: the first child of an
+// interior node follows it. The bounds of the lights below a node and the cone of their emission directions
+// drive the importance of the node for a shading point.
+struct LightTreeNode
+{
+  float3 boundsMin;   // Bounds of the lights
+  float  phi;         // Power of the lights
+  float3 boundsMax;   // Bounds of the lights
+  float  cosThetaO;   // Orientation cone: cosine of the spread of the emission axes around the axis
+  float3 axis;        // Orientation cone: axis
+  float  cosThetaE;   // Orientation cone: cosine of the emission angle around each emission axis
+  int    index;       // Interior node: second child, leaf: light
+  int    isLeaf;      // 1: leaf, a single light
+  int    _pad0;       // 64 bytes
+  int    _pad1;
+};
+
+// Emissive triangle of the next-event estimation (eEmissiveTriangles, emissive_builder.hpp), with its entry of
+// the alias table selecting the triangles in proportion to their emitted power
+struct EmissiveTriangle
+{
+  float prob;             // Probability of keeping this triangle, otherwise the alias is selected
+  int   alias;            // Triangle taking the rest of the entry
+  float pdf;              // Probability of selecting this triangle
+  float aliasPdf;         // Probability of selecting the alias
+  int   renderNode;       // Render node of the triangle (instance of the TLAS)
+  int   renderPrimitive;  // Render primitive of the node
+  int   triangleID;       // Triangle in the primitive
+  int   _pad0;            // 32 bytes
 };
 
 // Binding points for descriptors
@@ -112,6 +390,8 @@ struct SceneFrameInfo
   float3      infinitePlaneBaseColor = float3(0.5, 0.5, 0.5);  // Default gray color
   float       infinitePlaneMetallic  = 0.0;                    // Default non-metallic
   float       infinitePlaneRoughness = 0.5;                    // Default medium roughness
+  float       lightSelectProbability    = 0.5;  // Probability of sampling a light rather than the environment
+  float       emissiveSelectProbability = 0.0;  // Probability of a light sample picking an emissive triangle rather than a punctual light
 };
 
 // Push constant
@@ -125,15 +405,24 @@ struct PathtracePushConstant
   float focalDistance         = 0.0f;  // Focal distance for depth of field
   float aperture              = 0.0f;  // Aperture for depth of field
   int   useDlss               = 0;     // Use DLSS (0: no, 1: yes)
-  int   useQOLDS              = 0;     // Use QOLDS sampling (0: default, 1: QOLDS)
+  uint  sobolSeed             = 0;     // Sobol' scrambling seed of the render (SamplerType::eSamplerSobolOwen)
+  int   qoldsMode             = 0;     // QOLDS evaluation (QoldsMode)
+  int   qoldsPerPixel         = 1;     // Decorrelate the QOLDS sequence per pixel (0: no, 1: yes)
+  int   qoldsDimensions       = 0;     // Number of QOLDS dimensions uploaded; higher dimensions use PCG
+  int   qoldsDigits           = 5;     // Base-3 digits m of the QOLDS net (3^m points per epoch)
   int   useFastMSX			  = 0;     
   int   renderSelection       = 1;     // Padding to align the structure
+  int   wavefrontDepth        = 0;     // Wavefront: bounce of the dispatch
+  int   wavefrontStage        = 0;     // Wavefront: WavefrontStage of wfPrepareMain
+  int   wavefrontSample       = 0;     // Wavefront: sample of the frame (0 .. numSamples - 1)
   /// Infinite plane
   float2                 jitter;               // Jitter for the DLSS
   float2                 mouseCoord = {0, 0};  // Mouse coordinates (use for debug)
   SceneFrameInfo*        frameInfo;            // Camera info
   SkyPhysicalParameters* skyParams;            // Sky physical parameters
   GltfScene*             gltfScene;            // GLTF sceneF
+  WavefrontQueues*       wavefront;            // Wavefront queues (RenderTechnique::Wavefront)
+  PathtraceFrameState*   frameState;           // Adaptive sampling and time slicing state of the frame
 };
 
 // Push constant
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "emissive_builder.hpp"
+#include "light_alias_builder.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/ext/scalar_constants.hpp>
+#include <nvutils/parallel_work.hpp>
+#include <nvvkgltf/tinygltf_utils.hpp>
+
+namespace {
+// Luminance of a linear color (Rec. 709)
+double luminance(double r, double g, double b)
+{
+  return 0.2126 * r + 0.7152 * g + 0.0722 * b;
+}
+
+double srgbToLinear(double c)
+{
+  return (c <= 0.04045) ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+// Element of an accessor at a byte offset: glTF data is tightly packed, possibly unaligned
+template <typename T>
+T readElement(const uint8_t* data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+// Index of the vertex of a triangle corner, the corner itself for a non-indexed primitive
+uint32_t getIndex(const tinygltf::Model& model, const tinygltf::Primitive& primitive, size_t corner)
+{
+  if(primitive.indices < 0)
+    return uint32_t(corner);
+
+  const tinygltf::Accessor&   accessor   = model.accessors[primitive.indices];
+  const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer&     buffer     = model.buffers[bufferView.buffer];
+  const uint8_t*              data       = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+  const size_t                stride     = accessor.ByteStride(bufferView);
+
+  switch(accessor.componentType)
+  {
+    case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+      return readElement<uint32_t>(data + corner * stride);
+    case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+      return readElement<uint16_t>(data + corner * stride);
+    case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+      return readElement<uint8_t>(data + corner * stride);
+  }
+  return 0;
+}
+}  // namespace
+
+void EmissiveBuilder::build(const nvvkgltf::Scene& scene)
+{
+  const tinygltf::Model& model       = scene.getModel();
+  const auto&            renderNodes = scene.getRenderNodes();
+
+  // Average luminance of the textures used for emission, the others are never read
+  std::vector<double> averageLuminance(model.textures.size(), 1.0);
+  std::vector<int>    emissiveTextures;
+  for(const tinygltf::Material& material : model.materials)
+  {
+    const int texture = material.emissiveTexture.index;
+    if(texture >= 0 && texture < int(model.textures.size())
+       && std::find(emissiveTextures.begin(), emissiveTextures.end(), texture) == emissiveTextures.end())
+      emissiveTextures.push_back(texture);
+  }
+  nvutils::parallel_batches<1>(emissiveTextures.size(), [&](uint64_t i) {
+    averageLuminance[emissiveTextures[i]] = textureLuminance(model, emissiveTextures[i]);
+  });
+
+  std::vector<double> emission(model.materials.size());
+  for(size_t i = 0; i < model.materials.size(); i++)
+    emission[i] = materialEmission(model.materials[i], averageLuminance);
+
+  // Render nodes with an emissive material, and the place of their triangles in the table
+  std::vector<int> emissiveNodes;
+  m_nodeOffsets.assign(std::max<size_t>(renderNodes.size(), 1), -1);
+  m_triangleCount = 0;
+  for(size_t i = 0; i < renderNodes.size(); i++)
+  {
+    const nvvkgltf::RenderNode& renderNode = renderNodes[i];
+    const int                   materialID = renderNode.materialID;
+    if(!renderNode.visible || materialID < 0 || materialID >= int(emission.size()) || emission[materialID] <= 0.0)
+      continue;
+    m_nodeOffsets[i] = m_triangleCount;
+    m_triangleCount += int(scene.getRenderPrimitive(renderNode.renderPrimID).indexCount / 3);
+    emissiveNodes.push_back(int(i));
+  }
+
+  // Weights of the triangles: area times emission, every node filling its own range
+  std::vector<double>                     weights(m_triangleCount);
+  std::vector<shaderio::EmissiveTriangle> triangles(m_triangleCount);
+  nvutils::parallel_batches<1>(emissiveNodes.size(), [&](uint64_t i) {
+    const int                   nodeID     = emissiveNodes[i];
+    const nvvkgltf::RenderNode& renderNode = renderNodes[nodeID];
+    const std::vector<double>   areas =
+        triangleAreas(model, *scene.getRenderPrimitive(renderNode.renderPrimID).pPrimitive, renderNode.worldMatrix);
+    const int    offset = m_nodeOffsets[nodeID];
+    const size_t count  = std::min<size_t>(areas.size(), scene.getRenderPrimitive(renderNode.renderPrimID).indexCount / 3);
+    for(size_t t = 0; t < count; t++)
+    {
+      weights[offset + t]   = areas[t] * emission[renderNode.materialID];
+      triangles[offset + t] = {.renderNode      = nodeID,
+                               .renderPrimitive = renderNode.renderPrimID,
+                               .triangleID      = int(t)};
+    }
+  });
+
+  m_emissivePower = 0.0;
+  for(double weight : weights)
+    m_emissivePower += weight;
+  m_emissivePower *= 2.0 * glm::pi<double>();  // Lambertian emitter: radiance over the hemisphere of both sides
+
+  // Selection of the triangles: the alias table of the punctual lights, over the weights
+  const std::vector<shaderio::LightAliasEntry> table = LightAliasBuilder::buildAliasTable(weights);
+  for(size_t i = 0; i < table.size(); i++)
+  {
+    triangles[i].prob     = table[i].prob;
+    triangles[i].alias    = table[i].alias;
+    triangles[i].pdf      = table[i].pdf;
+    triangles[i].aliasPdf = table[i].aliasPdf;
+  }
+  m_triangles = std::move(triangles);
+  if(m_triangles.empty())
+    m_triangles.push_back({.prob = 1.0f});  // Keeps the buffer valid without emission
+}
+
+double EmissiveBuilder::materialEmission(const tinygltf::Material& material, const std::vector<double>& averageLuminance)
+{
+  const std::vector<double>& factor = material.emissiveFactor;
+  double emission = (factor.size() < 3) ? 0.0 : luminance(factor[0], factor[1], factor[2]);  // glTF default: black
+  if(tinygltf::utils::hasElementName(material.extensions, KHR_MATERIALS_EMISSIVE_STRENGTH_EXTENSION_NAME))
+    emission *= tinygltf::utils::getEmissiveStrength(material).emissiveStrength;
+
+  const int texture = material.emissiveTexture.index;
+  if(texture >= 0 && texture < int(averageLuminance.size()))
+    emission *= averageLuminance[texture];
+  return std::max(emission, 0.0);
+}
+
+double EmissiveBuilder::textureLuminance(const tinygltf::Model& model, int textureIndex)
+{
+  const int source = model.textures[textureIndex].source;
+  if(source < 0 || source >= int(model.images.size()))
+    return 1.0;
+  const tinygltf::Image& image     = model.images[source];
+  const int              bytes     = image.bits / 8;
+  const int              component = image.component;
+  if(image.width <= 0 || image.height <= 0 || component <= 0 || (bytes != 1 && bytes != 2)
+     || image.image.size() < size_t(image.width) * image.height * component * bytes)
+    return 1.0;  // Compressed or not loaded
+
+  // A grid of texels over the image, decoded from sRGB
+  const int    stepX = std::max(image.width / EMISSIVE_TEXTURE_SAMPLES, 1);
+  const int    stepY = std::max(image.height / EMISSIVE_TEXTURE_SAMPLES, 1);
+  const double scale = (bytes == 1) ? 1.0 / 255.0 : 1.0 / 65535.0;
+  double       sum   = 0.0;
+  size_t       count = 0;
+  for(int y = 0; y < image.height; y += stepY)
+  {
+    for(int x = 0; x < image.width; x += stepX)
+    {
+      const uint8_t* texel = image.image.data() + (size_t(y) * image.width + x) * component * bytes;
+      double         rgb[3];
+      for(int c = 0; c < 3; c++)
+      {
+        const int    channel = std::min(c, component - 1);  // Grey images
+        const double value   = (bytes == 1) ? texel[channel] : readElement<uint16_t>(texel + channel * 2);
+        rgb[c]               = srgbToLinear(value * scale);
+      }
+      sum += luminance(rgb[0], rgb[1], rgb[2]);
+      count++;
+    }
+  }
+  return sum / double(count);
+}
+
+std::vector<double> EmissiveBuilder::triangleAreas(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const glm::mat4& worldMatrix)
+{
+  auto position = primitive.attributes.find("POSITION");
+  if(position == primitive.attributes.end())
+    return {};
+
+  const tinygltf::Accessor&   accessor   = model.accessors[position->second];
+  const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer&     buffer     = model.buffers[bufferView.buffer];
+  const uint8_t*              data       = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+  const size_t                stride     = accessor.ByteStride(bufferView);
+
+  const size_t cornerCount = (primitive.indices >= 0) ? model.accessors[primitive.indices].count : accessor.count;
+  std::vector<double> areas(cornerCount / 3);
+  for(size_t t = 0; t < areas.size(); t++)
+  {
+    glm::vec3 p[3];
+    for(int c = 0; c < 3; c++)
+    {
+      const uint32_t index = getIndex(model, primitive, t * 3 + c);
+      p[c]                 = glm::vec3(worldMatrix * glm::vec4(readElement<glm::vec3>(data + index * stride), 1.0f));
+    }
+    areas[t] = 0.5 * double(glm::length(glm::cross(p[1] - p[0], p[2] - p[0])));
+  }
+  return areas;
+}
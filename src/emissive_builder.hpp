@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <nvvkgltf/scene.hpp>
+
+#include "shaders/shaderio.h"  // Shared between host and device
+
+//--------------------------------------------------------------------------------------------------
+// Constants
+//
+constexpr int EMISSIVE_TEXTURE_SAMPLES = 256;  // Texels per side read to average an emissive texture
+
+//--------------------------------------------------------------------------------------------------
+// EmissiveBuilder: Host-side emissive triangles of sampleLights() (emissive_lights.h.slang)
+//
+// Every triangle of a render node with an emissive material becomes an area light. Its weight is its
+// world-space area times the luminance of the emission of the material: emissive factor, emissive
+// strength, and the average of the emissive texture over the image. The materials and the nodes are
+// processed in parallel, and the weights drive an alias table, as for the punctual lights.
+// A table per render node gives its first emitter, so that a BSDF ray hitting an emissive triangle
+// finds the probability sampleLights() had of choosing it, for multiple importance sampling.
+//
+class EmissiveBuilder
+{
+public:
+  EmissiveBuilder()  = default;
+  ~EmissiveBuilder() = default;
+
+  // Collect the emissive triangles of the render nodes of the scene, with their alias table
+  void build(const nvvkgltf::Scene& scene);
+
+  // Get the emissive triangles for GPU upload (a single unused entry without emission)
+  const std::vector<shaderio::EmissiveTriangle>& getTriangles() const { return m_triangles; }
+
+  // Get the first emissive triangle of every render node, -1 without emission (at least one entry)
+  const std::vector<int>& getNodeOffsets() const { return m_nodeOffsets; }
+
+  // Get the number of emissive triangles
+  int getTriangleCount() const { return m_triangleCount; }
+
+  // Get the total power of the emissive triangles, emitting on both sides
+  double getEmissivePower() const { return m_emissivePower; }
+
+  // Luminance emitted by a material, the emissive texture counting with its average
+  // averageLuminance: average luminance of every texture of the model, 1 when unknown
+  static double materialEmission(const tinygltf::Material& material, const std::vector<double>& averageLuminance);
+
+  // Average linear luminance of a texture, 1 when its image is not in memory
+  static double textureLuminance(const tinygltf::Model& model, int textureIndex);
+
+  // World-space areas of the triangles of a primitive
+  static std::vector<double> triangleAreas(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const glm::mat4& worldMatrix);
+
+private:
+  int                                     m_triangleCount{0};
+  double                                  m_emissivePower{0.0};
+  std::vector<shaderio::EmissiveTriangle> m_triangles;
+  std::vector<int>                        m_nodeOffsets;
+};
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "guiding_tree_builder.hpp"
+#include <algorithm>
+#include <cmath>
+
+#include <glm/ext/scalar_constants.hpp>
+#include <nvutils/parallel_work.hpp>
+
+namespace {
+constexpr float ONE_MINUS_EPSILON = 0.99999994f;  // Largest float below 1, keeps the points in [0, 1)
+
+float quadtreeTotal(const shaderio::GuidingDirectionalNode& node)
+{
+  return node.sums.x + node.sums.y + node.sums.z + node.sums.w;
+}
+}  // namespace
+
+void GuidingTreeBuilder::reset(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+  m_boundsMin  = boundsMin;
+  m_boundsSize = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+  m_spatialNodes.assign(1, shaderio::GuidingSpatialNode{.child = 0, .axis = 0, .dtree = 0});
+  m_regions.assign(1, Region{.building = {shaderio::GuidingDirectionalNode{}}});
+  flatten();
+}
+
+void GuidingTreeBuilder::refine(const shaderio::GuidingRecord* records, uint32_t count)
+{
+  // Region of every record, then the records sorted by region
+  std::vector<int> recordRegions(count, -1);
+  nvutils::parallel_batches<4096>(count, [&](uint64_t i) {
+    const shaderio::GuidingRecord& record = records[i];
+    if(std::isfinite(record.position.x) && std::isfinite(record.position.y) && std::isfinite(record.position.z))
+      recordRegions[i] = findRegion(record.position);
+  });
+  std::vector<uint32_t> offsets(m_regions.size() + 1, 0);
+  for(int region : recordRegions)
+  {
+    if(region >= 0)
+      offsets[region + 1]++;
+  }
+  for(size_t r = 0; r < m_regions.size(); r++)
+    offsets[r + 1] += offsets[r];
+  std::vector<uint32_t> sorted(offsets.back());
+  std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+  for(uint32_t i = 0; i < count; i++)
+  {
+    if(recordRegions[i] >= 0)
+      sorted[cursor[recordRegions[i]]++] = i;
+  }
+
+  // Splat the radiance of every record over the pdf of its direction: a region integrates the
+  // radiance reaching it from every part of the sphere
+  nvutils::parallel_batches<1>(m_regions.size(), [&](uint64_t r) {
+    Region& region = m_regions[r];
+    for(uint32_t s = offsets[r]; s < offsets[r + 1]; s++)
+    {
+      const shaderio::GuidingRecord& record = records[sorted[s]];
+      region.records++;
+      const float value = (record.pdf > 0.0f) ? record.radiance / record.pdf : 0.0f;
+      if(value > 0.0f && std::isfinite(value))
+        splatQuadtree(region.building, directionToSquare(record.direction), value);
+    }
+  });
+
+  splitRegions();
+
+  // The built quadtrees are sampled in the next iteration, which builds refined ones
+  nvutils::parallel_batches<1>(m_regions.size(), [&](uint64_t r) {
+    Region& region  = m_regions[r];
+    region.sampling = std::move(region.building);
+    region.building = refineQuadtree(region.sampling, GUIDING_DIRECTIONAL_THRESHOLD);
+    region.records  = 0;
+  });
+  flatten();
+}
+
+int GuidingTreeBuilder::findRegion(const glm::vec3& position) const
+{
+  glm::vec3 p    = glm::clamp((position - m_boundsMin) / m_boundsSize, glm::vec3(0.0f), glm::vec3(ONE_MINUS_EPSILON));
+  int       node = 0;
+  while(m_spatialNodes[node].child != 0)
+  {
+    const int  axis = m_spatialNodes[node].axis;
+    const bool high = p[axis] >= 0.5f;
+    p[axis]         = 2.0f * p[axis] - (high ? 1.0f : 0.0f);
+    node            = m_spatialNodes[node].child + (high ? 1 : 0);
+  }
+  return m_spatialNodes[node].dtree;
+}
+
+void GuidingTreeBuilder::splitRegions()
+{
+  // The nodes appended by a split are visited in turn, and may split again
+  for(size_t n = 0; n < m_spatialNodes.size() && m_spatialNodes.size() + 2 <= GUIDING_MAX_SPATIAL_NODES; n++)
+  {
+    const shaderio::GuidingSpatialNode node = m_spatialNodes[n];
+    if(node.child != 0 || m_regions[node.dtree].records <= GUIDING_SPATIAL_THRESHOLD)
+      continue;
+
+    // Both halves start from the quadtrees of the region, with half of its records
+    m_regions[node.dtree].records /= 2;
+    const int copy = int(m_regions.size());
+    m_regions.push_back(m_regions[node.dtree]);
+
+    const int child         = int(m_spatialNodes.size());
+    const int axis          = (node.axis + 1) % 3;
+    m_spatialNodes[n].child = child;
+    m_spatialNodes[n].dtree = -1;
+    m_spatialNodes.push_back({.child = 0, .axis = axis, .dtree = node.dtree});
+    m_spatialNodes.push_back({.child = 0, .axis = axis, .dtree = copy});
+  }
+}
+
+void GuidingTreeBuilder::flatten()
+{
+  // The quadtrees of the leaves one after the other, their children moved by the offset of the tree.
+  // A region without radiance samples its BSDF only.
+  m_gpuSpatialNodes = m_spatialNodes;
+  m_gpuDirectionalNodes.clear();
+  m_hasDistribution = false;
+  for(shaderio::GuidingSpatialNode& node : m_gpuSpatialNodes)
+  {
+    if(node.child != 0)
+      continue;
+    const Region& region = m_regions[node.dtree];
+    if(region.sampling.empty() || quadtreeTotal(region.sampling[0]) <= 0.0f)
+    {
+      node.dtree = -1;
+      continue;
+    }
+
+    const int offset = int(m_gpuDirectionalNodes.size());
+    for(shaderio::GuidingDirectionalNode quad : region.sampling)
+    {
+      for(int q = 0; q < 4; q++)
+      {
+        if(quad.children[q] != 0)
+          quad.children[q] += offset;
+      }
+      m_gpuDirectionalNodes.push_back(quad);
+    }
+    node.dtree        = offset;
+    m_hasDistribution = true;
+  }
+  if(m_gpuDirectionalNodes.empty())
+    m_gpuDirectionalNodes.push_back({});  // Keeps the buffer valid before the first iteration
+}
+
+glm::vec2 GuidingTreeBuilder::directionToSquare(const glm::vec3& direction)
+{
+  const float cosTheta = std::clamp(direction.z, -1.0f, 1.0f);
+  float       phi      = std::atan2(direction.y, direction.x);
+  if(phi < 0.0f)
+    phi += 2.0f * glm::pi<float>();
+  const glm::vec2 p(0.5f * (cosTheta + 1.0f), phi / (2.0f * glm::pi<float>()));
+  return glm::clamp(p, glm::vec2(0.0f), glm::vec2(ONE_MINUS_EPSILON));
+}
+
+void GuidingTreeBuilder::splatQuadtree(std::vector<shaderio::GuidingDirectionalNode>& tree, glm::vec2 p, float value)
+{
+  int node = 0;
+  for(;;)
+  {
+    const glm::ivec2 xy = glm::ivec2(glm::greaterThanEqual(p, glm::vec2(0.5f)));
+    const int        q  = xy.x + 2 * xy.y;
+    tree[node].sums[q] += value;
+    p = 2.0f * p - glm::vec2(xy);
+    if(tree[node].children[q] == 0)
+      break;
+    node = tree[node].children[q];
+  }
+}
+
+std::vector<shaderio::GuidingDirectionalNode> GuidingTreeBuilder::refineQuadtree(const std::vector<shaderio::GuidingDirectionalNode>& tree,
+                                                                                 float threshold)
+{
+  std::vector<shaderio::GuidingDirectionalNode> result(1);
+  const float                                   total = quadtreeTotal(tree[0]);
+  if(total <= 0.0f)
+    return result;
+
+  // Depth-first over the source tree; the leaves of the source that are subdivided spread their
+  // radiance evenly over their quadrants
+  struct Entry
+  {
+    shaderio::GuidingDirectionalNode source;
+    int                              target;
+    int                              depth;
+  };
+  std::vector<Entry> stack{{tree[0], 0, 1}};
+  while(!stack.empty())
+  {
+    const Entry entry = stack.back();
+    stack.pop_back();
+    for(int q = 0; q < 4; q++)
+    {
+      if(entry.depth >= GUIDING_MAX_DEPTH || entry.source.sums[q] <= threshold * total)
+        continue;
+
+      shaderio::GuidingDirectionalNode source{};
+      if(entry.source.children[q] != 0)
+        source = tree[entry.source.children[q]];
+      else
+        source.sums = glm::vec4(0.25f * entry.source.sums[q]);
+
+      const int child                  = int(result.size());
+      result[entry.target].children[q] = child;
+      result.push_back({});
+      stack.push_back({source, child, entry.depth + 1});
+    }
+  }
+  return result;
+}
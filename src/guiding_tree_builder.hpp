@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shaders/shaderio.h"  // Shared between host and device
+
+//--------------------------------------------------------------------------------------------------
+// Constants
+//
+constexpr uint32_t GUIDING_SPATIAL_THRESHOLD     = 4000;     // Records of an iteration over which a region is halved
+constexpr float    GUIDING_DIRECTIONAL_THRESHOLD = 0.01f;    // Share of the radiance over which a quadrant is subdivided
+constexpr size_t   GUIDING_MAX_SPATIAL_NODES     = 1 << 16;  // Nodes of the spatial tree
+
+//--------------------------------------------------------------------------------------------------
+// GuidingTreeBuilder: Host-side SD-tree of the path guiding (path_guiding.h.slang)
+//
+// Müller et al., "Practical Path Guiding for Efficient Light-Transport Simulation" (2017). Every leaf
+// of the spatial binary tree is a region of the scene with two directional quadtrees: the one the
+// shader samples, learned in the previous iteration, and the one the records of this iteration are
+// splatted into. At the end of an iteration, the regions that received enough records are halved,
+// their quadtrees copied to both halves; the built quadtrees become the sampled ones, and the next
+// ones subdivide the quadrants holding more than a share of their radiance.
+// The records are sorted by region, then every region is splatted and refined in parallel.
+//
+class GuidingTreeBuilder
+{
+public:
+  GuidingTreeBuilder()  = default;
+  ~GuidingTreeBuilder() = default;
+
+  // Start over with a single region over a box, which has learned nothing
+  void reset(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+  // End of an iteration: learn from its records, refine the trees for the next one
+  void refine(const shaderio::GuidingRecord* records, uint32_t count);
+
+  // Get the spatial nodes for GPU upload: the leaves point to their sampled quadtree in getDirectionalNodes()
+  const std::vector<shaderio::GuidingSpatialNode>& getSpatialNodes() const { return m_gpuSpatialNodes; }
+
+  // Get the sampled quadtrees of all regions for GPU upload (a single unused node before the first iteration)
+  const std::vector<shaderio::GuidingDirectionalNode>& getDirectionalNodes() const { return m_gpuDirectionalNodes; }
+
+  // Box of the spatial tree
+  glm::vec3 getBoundsMin() const { return m_boundsMin; }
+  glm::vec3 getBoundsSize() const { return m_boundsSize; }
+
+  // Get the number of regions, leaves of the spatial tree
+  int getRegionCount() const { return int(m_regions.size()); }
+
+  // True when a region has a distribution to sample
+  bool hasDistribution() const { return m_hasDistribution; }
+
+  //--------------------------------------------------------------------------------------------------
+  // Directional quadtrees
+  //
+  // Point of the square of the cylindrical coordinates of a direction
+  static glm::vec2 directionToSquare(const glm::vec3& direction);
+
+  // Add radiance to the quadrants of every level holding a point of the square
+  static void splatQuadtree(std::vector<shaderio::GuidingDirectionalNode>& tree, glm::vec2 p, float value);
+
+  // Structure of the next quadtree: the quadrants with more than a share of the radiance of a tree are
+  // subdivided, the others are leaves. The radiance of the new tree is zero.
+  static std::vector<shaderio::GuidingDirectionalNode> refineQuadtree(const std::vector<shaderio::GuidingDirectionalNode>& tree,
+                                                                      float threshold);
+
+private:
+  // Leaf of the spatial tree
+  struct Region
+  {
+    std::vector<shaderio::GuidingDirectionalNode> building;  // Records of the current iteration
+    std::vector<shaderio::GuidingDirectionalNode> sampling;  // Learned in the previous iteration, empty before
+    uint32_t                                      records{0};
+  };
+
+  // Region of a point
+  int findRegion(const glm::vec3& position) const;
+
+  // Halve the regions that received more records than the threshold, recursively
+  void splitRegions();
+
+  // Flatten the spatial tree and the sampled quadtrees for the GPU
+  void flatten();
+
+  glm::vec3                                     m_boundsMin{0.0f};
+  glm::vec3                                     m_boundsSize{1.0f};
+  std::vector<shaderio::GuidingSpatialNode>     m_spatialNodes;  // dtree: index of the Region of a leaf
+  std::vector<Region>                           m_regions;
+  std::vector<shaderio::GuidingSpatialNode>     m_gpuSpatialNodes;
+  std::vector<shaderio::GuidingDirectionalNode> m_gpuDirectionalNodes;
+  bool                                          m_hasDistribution{false};
+};
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "light_alias_builder.hpp"
+#include <algorithm>
+#include <cmath>
+
+#include <glm/ext/scalar_constants.hpp>
+
+namespace {
+// Luminance of a linear color (Rec. 709)
+double luminance(const std::vector<double>& color)
+{
+  if(color.size() < 3)
+    return 1.0;  // glTF default: white
+  return 0.2126 * color[0] + 0.7152 * color[1] + 0.0722 * color[2];
+}
+}  // namespace
+
+void LightAliasBuilder::build(const nvvkgltf::Scene& scene)
+{
+  const tinygltf::Model& model       = scene.getModel();
+  const float            sceneRadius = scene.getSceneBounds().radius();
+
+  std::vector<double> powers;
+  powers.reserve(scene.getRenderLights().size());
+  for(const nvvkgltf::RenderLight& renderLight : scene.getRenderLights())
+  {
+    powers.push_back(lightPower(model.lights[renderLight.light], sceneRadius));
+  }
+
+  m_lightPower = 0.0;
+  for(double power : powers)
+    m_lightPower += power;
+
+  m_table = buildAliasTable(powers);
+  if(m_table.empty())
+    m_table.push_back({1.0f, 0, 0.0f, 0.0f});  // Keeps the buffer valid without lights
+}
+
+double LightAliasBuilder::radiantIntensity(const tinygltf::Light& light)
+{
+  return std::max(light.intensity * luminance(light.color), 0.0);
+}
+
+double LightAliasBuilder::lightPower(const tinygltf::Light& light, float sceneRadius)
+{
+  const double radiant = radiantIntensity(light);
+  const double pi      = glm::pi<double>();
+
+  if(light.type == "directional")
+    return pi * double(sceneRadius) * double(sceneRadius) * radiant;  // Irradiance over the disk of the scene
+  if(light.type == "spot")
+  {
+    // Solid angle of the cone, with the falloff counted halfway between the inner and outer angles
+    const double cosInner = std::cos(light.spot.innerConeAngle);
+    const double cosOuter = std::cos(light.spot.outerConeAngle);
+    return 2.0 * pi * (1.0 - 0.5 * (cosInner + cosOuter)) * radiant;
+  }
+  return 4.0 * pi * radiant;  // Point light, intensity over the sphere
+}
+
+double LightAliasBuilder::environmentPower(float integral, float intensity, float sceneRadius)
+{
+  // The integral is the radiance over the sphere of directions, each one lights the disk of the scene
+  return glm::pi<double>() * double(sceneRadius) * double(sceneRadius) * double(integral) * double(intensity);
+}
+
+float LightAliasBuilder::lightSelectProbability(double lightPower, double environmentPower)
+{
+  const double totalPower = lightPower + environmentPower;
+  if(environmentPower < 0.0 || totalPower <= 0.0)
+    return 0.5f;
+  // Power ignores the visibility: never starve the lights of an outdoor scene or the window of an interior
+  return std::clamp(float(lightPower / totalPower), LIGHT_SELECT_MIN_PROBABILITY, 1.0f - LIGHT_SELECT_MIN_PROBABILITY);
+}
+
+std::vector<shaderio::LightAliasEntry> LightAliasBuilder::buildAliasTable(const std::vector<double>& weights)
+{
+  const size_t count = weights.size();
+  std::vector<shaderio::LightAliasEntry> table(count);
+  if(count == 0)
+    return table;
+
+  double total = 0.0;
+  for(double weight : weights)
+    total += std::max(weight, 0.0);
+
+  // Weights scaled to an average of one, split into the entries under and over the average
+  std::vector<double> scaled(count);
+  std::vector<int>    small;
+  std::vector<int>    large;
+  for(size_t i = 0; i < count; i++)
+  {
+    const double pdf = (total > 0.0) ? std::max(weights[i], 0.0) / total : 1.0 / double(count);
+    table[i]         = {1.0f, int(i), float(pdf), float(pdf)};
+    scaled[i]        = pdf * double(count);
+    (scaled[i] < 1.0 ? small : large).push_back(int(i));
+  }
+
+  // Every small entry is filled up by a large one, which gives away that much of its weight
+  while(!small.empty() && !large.empty())
+  {
+    const int s = small.back();
+    small.pop_back();
+    const int l = large.back();
+
+    table[s].prob  = float(scaled[s]);
+    table[s].alias = l;
+    scaled[l]      = (scaled[l] + scaled[s]) - 1.0;
+    if(scaled[l] < 1.0)
+    {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // The leftovers are one up to rounding errors: they keep their own light (prob = 1)
+
+  for(shaderio::LightAliasEntry& entry : table)
+    entry.aliasPdf = table[entry.alias].pdf;
+  return table;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <nvvkgltf/scene.hpp>
+
+#include "shaders/shaderio.h"  // Shared between host and device
+
+//--------------------------------------------------------------------------------------------------
+// Constants
+//
+constexpr float LIGHT_SELECT_MIN_PROBABILITY = 0.05f;  // Share always kept by the lights and by the environment
+
+//--------------------------------------------------------------------------------------------------
+// LightAliasBuilder: Host-side power-weighted light selection of sampleLights()
+//
+// The emitted power of every render light (luminance of color x intensity, over the sphere, the cone
+// of a spot, or the scene disk for a directional light) drives a Walker/Vose alias table: the shader
+// picks a light in O(1) with one fetch, and the pdf of the pick is stored in the entry.
+// The split between the lights and the environment compares the power of all lights with the power
+// the environment brings into the scene bounds, from the integral of the HDR importance map.
+//
+class LightAliasBuilder
+{
+public:
+  LightAliasBuilder()  = default;
+  ~LightAliasBuilder() = default;
+
+  // Compute the power of the render lights of the scene and build the alias table over them,
+  // in the order of the lights buffer of SceneVk
+  void build(const nvvkgltf::Scene& scene);
+
+  // Get the alias table for GPU upload, one entry per render light (a single unused entry without lights)
+  const std::vector<shaderio::LightAliasEntry>& getTable() const { return m_table; }
+
+  // Get the total power of the lights
+  double getLightPower() const { return m_lightPower; }
+
+  // Luminance of the intensity of a glTF punctual light: candela, or lux for a directional light
+  static double radiantIntensity(const tinygltf::Light& light);
+
+  // Power of a glTF punctual light; a directional light lights the disk of the scene bounds
+  static double lightPower(const tinygltf::Light& light, float sceneRadius);
+
+  // Power of an environment of importance integral (hdrIbl.getIntegral()) entering the scene bounds
+  static double environmentPower(float integral, float intensity, float sceneRadius);
+
+  // Probability of sampling a light rather than the environment, SceneFrameInfo::lightSelectProbability
+  // environmentPower: negative when unknown (physical sky), the selection is then split evenly
+  static float lightSelectProbability(double lightPower, double environmentPower);
+
+  // Alias table of a discrete distribution, uniform when all weights are zero (Vose's method)
+  static std::vector<shaderio::LightAliasEntry> buildAliasTable(const std::vector<double>& weights);
+
+private:
+  double                                 m_lightPower{0.0};
+  std::vector<shaderio::LightAliasEntry> m_table;
+};
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "light_tree_builder.hpp"
+#include "light_alias_builder.hpp"
+#include <cmath>
+#include <limits>
+
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace {
+float safeAcos(float x)
+{
+  return std::acos(std::clamp(x, -1.0f, 1.0f));
+}
+
+float safeSqrt(float x)
+{
+  return std::sqrt(std::max(x, 0.0f));
+}
+
+glm::vec3 centroid(const shaderio::LightTreeNode& node)
+{
+  return 0.5f * (node.boundsMin + node.boundsMax);
+}
+}  // namespace
+
+void LightTreeBuilder::build(const nvvkgltf::Scene& scene)
+{
+  std::vector<shaderio::LightTreeNode> leaves;
+  collectLights(scene, leaves, m_infiniteLights);
+
+  m_nodes.clear();
+  m_nodes.reserve(maxNodes(scene.getRenderLights().size()));
+  if(!leaves.empty())
+    buildNode(leaves, 0, int(leaves.size()));
+  m_treeNodes = int(m_nodes.size());
+
+  // The directional lights follow the tree
+  for(int light : m_infiniteLights)
+  {
+    shaderio::LightTreeNode node{};
+    node.index  = light;
+    node.isLeaf = 1;
+    m_nodes.push_back(node);
+  }
+  if(m_nodes.empty())
+    m_nodes.push_back({});  // Keeps the buffer valid without lights
+}
+
+void LightTreeBuilder::update(const nvvkgltf::Scene& scene)
+{
+  std::vector<shaderio::LightTreeNode> leaves;
+  std::vector<int>                     infiniteLights;
+  collectLights(scene, leaves, infiniteLights);
+  if(infiniteLights != m_infiniteLights || (leaves.empty() != (m_treeNodes == 0)))
+  {
+    build(scene);
+    return;
+  }
+
+  // Same lights in the tree: the children follow their parent, refit from the last node up
+  std::vector<int> leafOfLight(scene.getRenderLights().size(), -1);
+  for(size_t i = 0; i < leaves.size(); i++)
+    leafOfLight[leaves[i].index] = int(i);
+
+  for(int i = m_treeNodes - 1; i >= 0; i--)
+  {
+    shaderio::LightTreeNode& node = m_nodes[i];
+    if(node.isLeaf)
+    {
+      node = leaves[leafOfLight[node.index]];
+    }
+    else
+    {
+      const int second = node.index;
+      node             = unionNodes(m_nodes[i + 1], m_nodes[second]);
+      node.index       = second;
+      node.isLeaf      = 0;
+    }
+  }
+}
+
+void LightTreeBuilder::collectLights(const nvvkgltf::Scene&                scene,
+                                     std::vector<shaderio::LightTreeNode>& leaves,
+                                     std::vector<int>&                     infiniteLights) const
+{
+  const tinygltf::Model& model        = scene.getModel();
+  const auto&            renderLights = scene.getRenderLights();
+
+  leaves.clear();
+  infiniteLights.clear();
+  for(size_t i = 0; i < renderLights.size(); i++)
+  {
+    shaderio::LightTreeNode node{};
+    if(lightNode(model.lights[renderLights[i].light], renderLights[i].worldMatrix, int(i), node))
+      leaves.push_back(node);
+    else
+      infiniteLights.push_back(int(i));
+  }
+}
+
+bool LightTreeBuilder::lightNode(const tinygltf::Light& light, const glm::mat4& worldMatrix, int lightIndex, shaderio::LightTreeNode& node)
+{
+  if(light.type == "directional")
+    return false;
+
+  const float     pi       = glm::pi<float>();
+  const glm::vec3 position = glm::vec3(worldMatrix[3]);
+  const float radius = light.extras.Has("radius") ? float(light.extras.Get("radius").GetNumberAsDouble()) : 0.0f;
+
+  node           = {};
+  node.boundsMin = position - glm::vec3(radius);
+  node.boundsMax = position + glm::vec3(radius);
+  node.phi       = float(4.0 * glm::pi<double>() * LightAliasBuilder::radiantIntensity(light));
+  node.index     = lightIndex;
+  node.isLeaf    = 1;
+  if(light.type == "spot")
+  {
+    // Full intensity inside the inner cone, falling off to zero at the outer one
+    const float innerAngle = float(light.spot.innerConeAngle);
+    const float outerAngle = std::max(float(light.spot.outerConeAngle), innerAngle);
+    node.axis              = glm::normalize(glm::mat3(worldMatrix) * glm::vec3(0.0f, 0.0f, -1.0f));
+    node.cosThetaO         = std::cos(innerAngle);
+    node.cosThetaE         = std::cos(outerAngle - innerAngle);
+  }
+  else
+  {
+    // Point light: every direction
+    node.axis      = glm::vec3(0.0f, 0.0f, 1.0f);
+    node.cosThetaO = -1.0f;
+    node.cosThetaE = std::cos(0.5f * pi);
+  }
+  return true;
+}
+
+shaderio::LightTreeNode LightTreeBuilder::unionNodes(const shaderio::LightTreeNode& a, const shaderio::LightTreeNode& b)
+{
+  if(a.phi == 0.0f)
+    return b;
+  if(b.phi == 0.0f)
+    return a;
+
+  shaderio::LightTreeNode node{};
+  node.boundsMin = glm::min(a.boundsMin, b.boundsMin);
+  node.boundsMax = glm::max(a.boundsMax, b.boundsMax);
+  node.phi       = a.phi + b.phi;
+  node.cosThetaE = std::min(a.cosThetaE, b.cosThetaE);
+
+  // Cone bounding both cones (pbrt-v4 DirectionCone Union)
+  const float pi     = glm::pi<float>();
+  const float thetaA = safeAcos(a.cosThetaO);
+  const float thetaB = safeAcos(b.cosThetaO);
+  const float thetaD = safeAcos(glm::dot(a.axis, b.axis));
+  if(std::min(thetaD + thetaB, pi) <= thetaA)
+  {
+    node.axis      = a.axis;
+    node.cosThetaO = a.cosThetaO;
+    return node;
+  }
+  if(std::min(thetaD + thetaA, pi) <= thetaB)
+  {
+    node.axis      = b.axis;
+    node.cosThetaO = b.cosThetaO;
+    return node;
+  }
+
+  const float     thetaO = 0.5f * (thetaA + thetaD + thetaB);
+  const glm::vec3 wr     = glm::cross(a.axis, b.axis);
+  if(thetaO >= pi || glm::dot(wr, wr) == 0.0f)
+  {
+    node.axis      = a.axis;
+    node.cosThetaO = -1.0f;  // Every direction
+    return node;
+  }
+  // Rotate the axis of a toward b, so that the cone just reaches the far side of b
+  node.axis      = glm::normalize(glm::angleAxis(thetaO - thetaA, glm::normalize(wr)) * a.axis);
+  node.cosThetaO = std::cos(thetaO);
+  return node;
+}
+
+float LightTreeBuilder::evaluateCost(const shaderio::LightTreeNode& node, const glm::vec3& parentExtent, int axis)
+{
+  const float pi        = glm::pi<float>();
+  const float thetaO    = safeAcos(node.cosThetaO);
+  const float thetaE    = safeAcos(node.cosThetaE);
+  const float thetaW    = std::min(thetaO + thetaE, pi);
+  const float sinThetaO = safeSqrt(1.0f - node.cosThetaO * node.cosThetaO);
+
+  // Solid angle measure of the emission: the cone, and the emission angle around its border
+  const float mOmega = 2.0f * pi * (1.0f - node.cosThetaO)
+                       + 0.5f * pi
+                             * (2.0f * thetaW * sinThetaO - std::cos(thetaO - 2.0f * thetaW)
+                                - 2.0f * thetaO * sinThetaO + node.cosThetaO);
+
+  // Long thin boxes split across their length are penalized
+  const float kr = std::max({parentExtent.x, parentExtent.y, parentExtent.z}) / parentExtent[axis];
+
+  const glm::vec3 extent = node.boundsMax - node.boundsMin;
+  const float     area   = 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+  return node.phi * mOmega * kr * area;
+}
+
+int LightTreeBuilder::buildNode(std::vector<shaderio::LightTreeNode>& leaves, int begin, int end)
+{
+  const int nodeIndex = int(m_nodes.size());
+  if(end - begin == 1)
+  {
+    m_nodes.push_back(leaves[begin]);
+    return nodeIndex;
+  }
+  m_nodes.emplace_back();
+
+  // Bounds of the lights and of their centroids
+  glm::vec3 boundsMin(std::numeric_limits<float>::max());
+  glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+  glm::vec3 centroidMin = boundsMin;
+  glm::vec3 centroidMax = boundsMax;
+  for(int i = begin; i < end; i++)
+  {
+    boundsMin   = glm::min(boundsMin, leaves[i].boundsMin);
+    boundsMax   = glm::max(boundsMax, leaves[i].boundsMax);
+    centroidMin = glm::min(centroidMin, centroid(leaves[i]));
+    centroidMax = glm::max(centroidMax, centroid(leaves[i]));
+  }
+  const glm::vec3 extent = boundsMax - boundsMin;
+
+  // Lowest cost split among the bucket boundaries of every axis
+  float minCost   = std::numeric_limits<float>::max();
+  int   minAxis   = -1;
+  int   minBucket = -1;
+  for(int axis = 0; axis < 3; axis++)
+  {
+    if(centroidMax[axis] == centroidMin[axis])
+      continue;
+
+    auto bucketOf = [&](const shaderio::LightTreeNode& leaf) {
+      const float t = (centroid(leaf)[axis] - centroidMin[axis]) / (centroidMax[axis] - centroidMin[axis]);
+      return std::min(int(t * LIGHT_TREE_BUCKETS), LIGHT_TREE_BUCKETS - 1);
+    };
+    shaderio::LightTreeNode buckets[LIGHT_TREE_BUCKETS]{};
+    for(int i = begin; i < end; i++)
+    {
+      shaderio::LightTreeNode& bucket = buckets[bucketOf(leaves[i])];
+      bucket                          = unionNodes(bucket, leaves[i]);
+    }
+
+    for(int split = 0; split < LIGHT_TREE_BUCKETS - 1; split++)
+    {
+      shaderio::LightTreeNode below{};
+      shaderio::LightTreeNode above{};
+      for(int b = 0; b <= split; b++)
+        below = unionNodes(below, buckets[b]);
+      for(int b = split + 1; b < LIGHT_TREE_BUCKETS; b++)
+        above = unionNodes(above, buckets[b]);
+
+      const float cost = evaluateCost(below, extent, axis) + evaluateCost(above, extent, axis);
+      if(cost < minCost)
+      {
+        minCost   = cost;
+        minAxis   = axis;
+        minBucket = split;
+      }
+    }
+  }
+
+  // Partition at the split, or in the middle when the lights are at the same spot
+  int mid = (begin + end) / 2;
+  if(minAxis >= 0)
+  {
+    auto below = [&](const shaderio::LightTreeNode& leaf) {
+      const float t = (centroid(leaf)[minAxis] - centroidMin[minAxis]) / (centroidMax[minAxis] - centroidMin[minAxis]);
+      return std::min(int(t * LIGHT_TREE_BUCKETS), LIGHT_TREE_BUCKETS - 1) <= minBucket;
+    };
+    const int split = int(std::partition(leaves.begin() + begin, leaves.begin() + end, below) - leaves.begin());
+    if(split != begin && split != end)
+      mid = split;
+  }
+
+  // The first child follows its parent, the second one comes after the whole first sub-tree
+  buildNode(leaves, begin, mid);
+  const int second = buildNode(leaves, mid, end);
+
+  shaderio::LightTreeNode& node = m_nodes[nodeIndex];
+  node                          = unionNodes(m_nodes[nodeIndex + 1], m_nodes[second]);
+  node.index                    = second;
+  node.isLeaf                   = 0;
+  return nodeIndex;
+}
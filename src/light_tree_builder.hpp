@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <nvvkgltf/scene.hpp>
+
+#include "shaders/shaderio.h"  // Shared between host and device
+
+//--------------------------------------------------------------------------------------------------
+// Constants
+//
+constexpr int LIGHT_TREE_BUCKETS = 12;  // Candidate split planes per axis of the SAH-like build
+
+//--------------------------------------------------------------------------------------------------
+// LightTreeBuilder: Host-side light BVH of sampleLights() (light_tree.h.slang)
+//
+// Conty and Kulla's "Importance Sampling of Many Lights with Adaptive Tree Splitting" (2018), in the
+// form of pbrt-v4's BVHLightSampler: every node bounds the position of its lights, the cone of their
+// emission directions and their power. The build is top-down, splitting at the bucket boundary of
+// the lowest surface area orientation heuristic cost, with one light per leaf. The shader walks down
+// the tree, choosing a child in proportion to its importance for the shading point.
+// Directional lights have no position: they are leaves stored after the tree, sampled uniformly.
+//
+class LightTreeBuilder
+{
+public:
+  LightTreeBuilder()  = default;
+  ~LightTreeBuilder() = default;
+
+  // Build the tree over the point and spot lights of the scene, in the order of the lights buffer of SceneVk
+  void build(const nvvkgltf::Scene& scene);
+
+  // Follow the lights that moved or changed: refit the bounds and cones of the tree, bottom-up.
+  // The tree is rebuilt when a light turned to or from directional.
+  void update(const nvvkgltf::Scene& scene);
+
+  // Get the nodes for GPU upload: the tree, then the directional lights (a single unused node without lights)
+  const std::vector<shaderio::LightTreeNode>& getNodes() const { return m_nodes; }
+
+  // Get the number of nodes of the tree, before the directional lights
+  int getTreeNodes() const { return m_treeNodes; }
+
+  // Get the number of directional lights
+  int getInfiniteLights() const { return int(m_infiniteLights.size()); }
+
+  // Most nodes of a scene, whatever the type of its lights: size of the GPU buffer
+  static size_t maxNodes(size_t numLights) { return std::max<size_t>(2 * numLights, 1); }
+
+  //--------------------------------------------------------------------------------------------------
+  // Bounds of the lights
+  //
+  // Leaf of a light at its world transform, false for a directional light
+  static bool lightNode(const tinygltf::Light& light, const glm::mat4& worldMatrix, int lightIndex, shaderio::LightTreeNode& node);
+
+  // Node bounding two nodes; a node without power is empty
+  static shaderio::LightTreeNode unionNodes(const shaderio::LightTreeNode& a, const shaderio::LightTreeNode& b);
+
+  // Surface area orientation heuristic of a node, split along an axis of the bounds of its parent
+  static float evaluateCost(const shaderio::LightTreeNode& node, const glm::vec3& parentExtent, int axis);
+
+private:
+  // Build the sub-tree of the lights [begin, end), returns its root
+  int buildNode(std::vector<shaderio::LightTreeNode>& leaves, int begin, int end);
+
+  // Split the lights of the scene into the tree ones and the directional ones, with their leaves
+  void collectLights(const nvvkgltf::Scene& scene, std::vector<shaderio::LightTreeNode>& leaves, std::vector<int>& infiniteLights) const;
+
+  int                                  m_treeNodes{0};
+  std::vector<int>                     m_infiniteLights;  // Directional lights
+  std::vector<shaderio::LightTreeNode> m_nodes;           // Tree, depth-first, then the directional lights
+};
@@ -19,12 +19,33 @@
 
 
 #include "qolds_builder.hpp"
+#include "qolds_matrices.hpp"
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <random>
-#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <climits>
 #include <cstring>
 
+#include <nvutils/parallel_work.hpp>
+
+namespace {
+// Hash of the counter-based RNG (FCRNG) used for Owen scrambling in qolds_sampling.h.slang
+uint32_t fcrngHash(uint32_t x)
+{
+  x ^= x >> 16u;
+  x *= 0x21f0aaadu;
+  x ^= x >> 15u;
+  x *= 0xd35a2d97u;
+  x ^= x >> 15u;
+  return x;
+}
+}  // namespace
+
 //--------------------------------------------------------------------------------------------------
 // Load irreducible polynomials from initialization file
 //
@@ -37,34 +58,34 @@ bool QOLDSBuilder::loadInitData(const std::string& filepath)
     return false;
   }
 
-  // Skip header lines (starting with 'd')
-  char c = file.get();
-  if(c == 'd')
-  {
-    file.ignore(256, '\n');
-  }
-  else
+  m_initDimensions = readInitData(file);
+  if(m_initDimensions == 0)
   {
-    file.putback(c);
+    std::cerr << "[QOLDS] Error: No initialization data in: " << filepath << std::endl;
+    return false;
   }
 
-  // Second header line
-  c = file.get();
-  if(c == 'd')
-  {
-    file.ignore(256, '\n');
-  }
-  else
-  {
-    file.putback(c);
-  }
+  std::cout << "[QOLDS] Loaded initialization data for " << m_initDimensions << " dimensions" << std::endl;
+  return true;
+}
 
-  // Read initialization data
-  int32_t index = 1;  // Start from dimension 1 (dimension 0 is special)
-  while(file.good() && index < QOLDS_MAX_DIMENSIONS)
+//--------------------------------------------------------------------------------------------------
+// Parse the rows "d s a m_1 .. m_s" into the slots 1, 2, ... (header lines start with 'd')
+// Returns the number of dimensions read
+//
+int QOLDSBuilder::readInitData(std::istream& file)
+{
+  int         index = 1;  // Start from dimension 1 (dimension 0 is special)
+  std::string line;
+  while(index < QOLDS_MAX_DIMENSIONS && std::getline(file, line))
   {
-    int32_t d, sj, aj;
-    file >> d >> sj >> aj;
+    if(line.empty() || line[0] == 'd')
+      continue;
+
+    std::istringstream row(line);
+    int32_t            d, sj, aj;
+    if(!(row >> d >> sj >> aj) || sj < 1 || sj > QOLDS_SEQUENCE_LENGTH)
+      break;
 
     m_sobol_aj[index] = aj;
     m_sobol_sj[index] = sj;
@@ -73,22 +94,195 @@ bool QOLDSBuilder::loadInitData(const std::string& filepath)
     // Read direction numbers
     for(int i = 0; i < sj; ++i)
     {
-      file >> m_sobol_mk[index][i];
+      row >> m_sobol_mk[index][i];
     }
+    if(!row)
+      break;
 
     index++;
   }
+  return index - 1;
+}
 
-  std::cout << "[QOLDS] Loaded initialization data for " << (index - 1) << " dimensions" << std::endl;
+//--------------------------------------------------------------------------------------------------
+// Same data from the compile-time copy of the file
+//
+void QOLDSBuilder::loadBakedInitData()
+{
+  for(int i = 0; i < qolds::kBakedDimensions; i++)
+  {
+    const qolds::InitRow& row = qolds::kInitData[i];
+    m_sobol_dj[i + 1]         = row.d;
+    m_sobol_sj[i + 1]         = row.s;
+    m_sobol_aj[i + 1]         = row.a;
+    for(int k = 0; k < row.s; k++)
+    {
+      m_sobol_mk[i + 1][k] = row.m[k];
+    }
+  }
+  m_initDimensions = qolds::kBakedDimensions;
+}
+
+int QOLDSBuilder::getBakedDimensions()
+{
+  return qolds::kBakedDimensions;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Extend the initialization data with searched dimensions
+//
+bool QOLDSBuilder::extendInitData(int dimensions, const std::string& cachePath)
+{
+  if(dimensions < 1 || dimensions > QOLDS_MAX_DIMENSIONS - 1)
+  {
+    std::cerr << "[QOLDS] Error: Invalid number of dimensions: " << dimensions << std::endl;
+    return false;
+  }
+  if(dimensions <= m_initDimensions)
+    return true;
+  if(!cachePath.empty() && loadInitCache(cachePath, dimensions))
+    return true;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  // Irreducible polynomials not used yet, in increasing order (degree 7 is enough for 255 dimensions)
+  std::vector<int32_t> polynomials = irreduciblePolynomials(7);
+  std::vector<int32_t> ranks;
+  for(size_t i = 0; i < polynomials.size(); i++)
+  {
+    if(std::find(m_sobol_aj + 1, m_sobol_aj + 1 + m_initDimensions, polynomials[i]) == m_sobol_aj + 1 + m_initDimensions)
+      ranks.push_back(int32_t(i));
+  }
+
+  // Matrices of the dimensions, the previous ones are scored against the candidates
+  struct Matrix
+  {
+    int32_t trits[QOLDS_SEQUENCE_LENGTH][QOLDS_SEQUENCE_LENGTH];
+  };
+  std::vector<Matrix> matrices(size_t(dimensions) + 1);
+  for(int d = std::max(1, m_initDimensions + 1 - QOLDS_SEARCH_WINDOW); d <= m_initDimensions; d++)
+  {
+    generateMkGF3(m_sobol_aj[d], m_sobol_sj[d], m_sobol_mk[d], 3);
+    fillMatrix(d, matrices[d].trits);
+  }
+
+  for(int d = m_initDimensions + 1; d <= dimensions; d++)
+  {
+    const int32_t rank   = ranks[size_t(d - m_initDimensions - 1)];
+    int32_t       degree = 1;
+    while(pow3Tab[degree + 1] <= uint32_t(polynomials[rank]))
+      degree++;
+    m_sobol_dj[d] = rank + 1;
+    m_sobol_sj[d] = degree;
+    m_sobol_aj[d] = polynomials[rank];
+
+    // Candidate m_k: in [1, 3^k) and not a multiple of 3 (non-zero diagonal)
+    std::default_random_engine rng(static_cast<uint32_t>(d));
+    int32_t                    best[QOLDS_SEQUENCE_LENGTH] = {};
+    int                        bestWorst = INT_MAX, bestSum = INT_MAX;
+    for(int candidate = 0; candidate < QOLDS_SEARCH_CANDIDATES; candidate++)
+    {
+      for(int k = 0; k < degree; k++)
+      {
+        const uint32_t r       = rng() % (2u * pow3Tab[k]);
+        m_sobol_mk[d][k] = int32_t(3u * (r / 2u) + 1u + (r & 1u));
+      }
+      generateMkGF3(m_sobol_aj[d], degree, m_sobol_mk[d], 3);
+      fillMatrix(d, matrices[d].trits);
+
+      // Sum over m of the t-values of the 2D projections with the previous dimensions, keep the worst
+      int worst = 0, sum = 0;
+      for(int e = std::max(1, d - QOLDS_SEARCH_WINDOW); e < d; e++)
+      {
+        const int32_t* pair[2] = {&matrices[e].trits[0][0], &matrices[d].trits[0][0]};
+        int            t       = 0;
+        for(int m = 2; m <= QOLDS_SEQUENCE_LENGTH; m++)
+          t += netQuality(pair, 2, m, QOLDS_SEQUENCE_LENGTH);
+        worst = std::max(worst, t);
+        sum += t;
+      }
+      if(worst < bestWorst || (worst == bestWorst && sum < bestSum))
+      {
+        bestWorst = worst;
+        bestSum   = sum;
+        std::copy(m_sobol_mk[d], m_sobol_mk[d] + degree, best);
+      }
+    }
+
+    std::copy(best, best + degree, m_sobol_mk[d]);
+    generateMkGF3(m_sobol_aj[d], degree, m_sobol_mk[d], 3);
+    fillMatrix(d, matrices[d].trits);
+  }
+
+  const int searched = dimensions - m_initDimensions;
+  m_initDimensions   = dimensions;
+
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  std::cout << "[QOLDS] Searched " << searched << " dimensions past the initialization data (" << ms << " ms)" << std::endl;
+
+  if(!cachePath.empty())
+    saveInitCache(cachePath);
   return true;
 }
 
+//--------------------------------------------------------------------------------------------------
+// The cache is valid if it has enough dimensions and starts with the current initialization data
+//
+bool QOLDSBuilder::loadInitCache(const std::string& cachePath, int dimensions)
+{
+  std::ifstream file(cachePath);
+  if(!file.is_open())
+    return false;
+
+  auto cache = std::make_unique<QOLDSBuilder>();
+  if(cache->readInitData(file) < dimensions)
+    return false;
+
+  for(int d = 1; d <= m_initDimensions; d++)
+  {
+    if(cache->m_sobol_aj[d] != m_sobol_aj[d] || cache->m_sobol_sj[d] != m_sobol_sj[d]
+       || !std::equal(m_sobol_mk[d], m_sobol_mk[d] + m_sobol_sj[d], cache->m_sobol_mk[d]))
+      return false;
+  }
+
+  for(int d = m_initDimensions + 1; d <= dimensions; d++)
+  {
+    m_sobol_dj[d] = cache->m_sobol_dj[d];
+    m_sobol_sj[d] = cache->m_sobol_sj[d];
+    m_sobol_aj[d] = cache->m_sobol_aj[d];
+    std::copy(cache->m_sobol_mk[d], cache->m_sobol_mk[d] + m_sobol_sj[d], m_sobol_mk[d]);
+  }
+
+  std::cout << "[QOLDS] Loaded " << (dimensions - m_initDimensions) << " searched dimensions from " << cachePath << std::endl;
+  m_initDimensions = dimensions;
+  return true;
+}
+
+void QOLDSBuilder::saveInitCache(const std::string& cachePath) const
+{
+  std::ofstream file(cachePath);
+  if(!file.is_open())
+  {
+    std::cerr << "[QOLDS] Warning: Could not write the initialization cache: " << cachePath << std::endl;
+    return;
+  }
+
+  file << "d\ts\ta\tm_i\n";
+  for(int d = 1; d <= m_initDimensions; d++)
+  {
+    file << m_sobol_dj[d] << '\t' << m_sobol_sj[d] << '\t' << m_sobol_aj[d];
+    for(int k = 0; k < m_sobol_sj[d]; k++)
+      file << '\t' << m_sobol_mk[d][k];
+    file << '\n';
+  }
+}
+
 //--------------------------------------------------------------------------------------------------
 // Build generator matrices for D dimensions using m digits
 //
 void QOLDSBuilder::buildMatrices(int dimensions, int digits)
 {
-  if(dimensions < 1 || dimensions > QOLDS_MAX_DIMENSIONS)
+  if(dimensions < 1 || dimensions > m_initDimensions)
   {
     std::cerr << "[QOLDS] Error: Invalid number of dimensions: " << dimensions << std::endl;
     return;
@@ -103,52 +297,421 @@ void QOLDSBuilder::buildMatrices(int dimensions, int digits)
   m_dimensions = dimensions;
   m_digits     = digits;
 
-  // Clear previous matrices
-  m_matrices.clear();
-  m_flattenedMatrices.clear();
+  // Sized once, each dimension then writes its own slice
+  m_flattenedMatrices.resize(size_t(dimensions) * digits * digits);
+  m_packedMatrices.resize(size_t(dimensions) * digits);
+
+  // Build matrices for each dimension, in parallel (the direction numbers of a dimension only touch its own row)
+  nvutils::parallel_batches<1>(uint64_t(dimensions), [&](uint64_t i) {
+    const int d = int(i) + 1;
 
-  // Build matrices for each dimension
-  for(int d = 1; d <= dimensions; d++)
-  {
     // Generate Sobol' direction numbers
     generateMkGF3(m_sobol_aj[d], m_sobol_sj[d], m_sobol_mk[d], 3);
 
     // Create matrix for this dimension
-    std::vector<std::vector<int32_t>> matrix(QOLDS_MATRIX_SIZE, std::vector<int32_t>(QOLDS_MATRIX_SIZE, 0));
+    int32_t matrix[QOLDS_SEQUENCE_LENGTH][QOLDS_SEQUENCE_LENGTH] = {};
     fillMatrix(d, matrix);
 
-    m_matrices.push_back(matrix);
-
     // Flatten matrix for GPU upload (only m x m portion)
+    int32_t* flattened = &m_flattenedMatrices[i * digits * digits];
     for(int row = 0; row < digits; row++)
     {
       for(int col = 0; col < digits; col++)
       {
-        m_flattenedMatrices.push_back(matrix[row][col]);
+        flattened[row * digits + col] = matrix[row][col];
       }
     }
-  }
+
+    // Pack each column, read bottom-up as in point3_digits
+    uint32_t* packed = &m_packedMatrices[i * digits];
+    for(int col = 0; col < digits; col++)
+    {
+      uint32_t column = 0;
+      for(int j = 0; j < digits; j++)
+      {
+        column |= PackedTrits::fromDigit(uint32_t(j), uint32_t(matrix[digits - 1 - j][col]));
+      }
+      packed[col] = column;
+    }
+  });
 
   std::cout << "[QOLDS] Built " << dimensions << " matrices of size " << digits << "x" << digits
             << " (max " << getMaxPoints() << " points)" << std::endl;
 }
 
+//--------------------------------------------------------------------------------------------------
+// Copy the compile-time matrices: the m x m corner of each baked matrix and its packed columns
+//
+void QOLDSBuilder::buildBakedMatrices(int dimensions, int digits)
+{
+  if(dimensions < 1 || dimensions > qolds::kBakedDimensions)
+  {
+    std::cerr << "[QOLDS] Error: Invalid number of baked dimensions: " << dimensions << std::endl;
+    return;
+  }
+
+  if(digits < 1 || digits > QOLDS_SEQUENCE_LENGTH)
+  {
+    std::cerr << "[QOLDS] Error: Invalid number of digits: " << digits << std::endl;
+    return;
+  }
+
+  m_dimensions = dimensions;
+  m_digits     = digits;
+
+  m_flattenedMatrices.resize(size_t(dimensions) * digits * digits);
+  m_packedMatrices.resize(size_t(dimensions) * digits);
+  for(int d = 0; d < dimensions; d++)
+  {
+    for(int row = 0; row < digits; row++)
+    {
+      for(int col = 0; col < digits; col++)
+      {
+        m_flattenedMatrices[(size_t(d) * digits + row) * digits + col] = qolds::kBakedMatrices[d][row][col];
+      }
+    }
+    for(int col = 0; col < digits; col++)
+    {
+      m_packedMatrices[size_t(d) * digits + col] = qolds::packedColumn(d, digits, col);
+    }
+  }
+
+  std::cout << "[QOLDS] Copied " << dimensions << " baked matrices of size " << digits << "x" << digits
+            << " (max " << getMaxPoints() << " points)" << std::endl;
+}
+
 //--------------------------------------------------------------------------------------------------
 // Generate random scrambling seeds
 //
 void QOLDSBuilder::generateScrambleSeeds(uint32_t masterSeed)
 {
-  m_seeds.clear();
+  if(masterSeed == 0)
+  {
+    std::random_device hwseed;
+    masterSeed = hwseed();
+  }
+
+  m_seeds.resize(m_dimensions);
+  m_scrambleTree.resize(size_t(m_dimensions) * QOLDS_TREE_WORDS);
+  rescramble(masterSeed);
 
-  std::random_device hwseed;
-  std::default_random_engine rng(masterSeed == 0 ? hwseed() : masterSeed);
+  std::cout << "[QOLDS] Generated " << m_dimensions << " scrambling seeds and trees ("
+            << m_scrambleTree.size() * sizeof(uint32_t) << " bytes)" << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Regenerate the seeds and the scramble tree in the buffers sized by generateScrambleSeeds()
+//
+void QOLDSBuilder::rescramble(uint32_t masterSeed)
+{
+  if(m_seeds.size() != size_t(m_dimensions))
+  {
+    generateScrambleSeeds(masterSeed);
+    return;
+  }
 
+  std::default_random_engine rng(masterSeed);
   for(int d = 0; d < m_dimensions; d++)
   {
-    m_seeds.push_back(rng());
+    m_seeds[d] = rng();
   }
 
-  std::cout << "[QOLDS] Generated " << m_dimensions << " scrambling seeds" << std::endl;
+  // Scramble tree: the permutations of the first levels, which every sample visits
+  for(int d = 0; d < m_dimensions; d++)
+  {
+    const uint32_t key  = (m_seeds[d] << 1u) | 1u;
+    uint32_t*      tree = &m_scrambleTree[size_t(d) * QOLDS_TREE_WORDS];
+    for(uint32_t word = 0; word < uint32_t(QOLDS_TREE_WORDS); word++)
+    {
+      const uint32_t first = word * QOLDS_TREE_NODES_PER_WORD;
+      const uint32_t last  = std::min(first + QOLDS_TREE_NODES_PER_WORD, uint32_t(QOLDS_TREE_NODES));
+      uint32_t       bits  = 0;
+      for(uint32_t node = first; node < last; node++)
+      {
+        bits |= nodePermutation(node, key) << (3u * (node - first));
+      }
+      tree[word] = bits;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Build the scrambled point table
+// Each dimension stores its 3^m points in index order, so the shader replaces the digit loop and
+// the scrambling with a single indexed load.
+//
+void QOLDSBuilder::buildPointTable(TableFormat format)
+{
+  if(m_flattenedMatrices.empty() || m_seeds.size() != size_t(m_dimensions))
+  {
+    std::cerr << "[QOLDS] Error: Matrices and scrambling seeds must be built before the point table" << std::endl;
+    return;
+  }
+
+  m_tableFormat = format;
+
+  const uint32_t numPoints = pow3Tab[m_digits];
+  const uint32_t stride    = getPointTableStride();
+  m_pointTable.assign(size_t(m_dimensions) * stride, 0u);
+
+  // One dimension per task, each writes its own row
+  nvutils::parallel_batches<1>(uint64_t(m_dimensions), [&](uint64_t dim) {
+    const int d   = int(dim);
+    uint32_t* row = &m_pointTable[size_t(d) * stride];
+    for(uint32_t i = 0; i < numPoints; i++)
+    {
+      float x = samplePoint(i, d);
+      if(format == TableFormat::eFloat32)
+      {
+        std::memcpy(&row[i], &x, sizeof(float));
+      }
+      else
+      {
+        uint32_t v = std::min(uint32_t(x * 65536.0f), 65535u);
+        row[i >> 1] |= v << ((i & 1u) * 16u);
+      }
+    }
+  });
+
+  std::cout << "[QOLDS] Built point table: " << m_dimensions << " x " << numPoints << " points ("
+            << (format == TableFormat::eFloat32 ? "float32" : "unorm16") << ", "
+            << m_pointTable.size() * sizeof(uint32_t) / 1024 << " KB)" << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// CPU reference of qolds_sample()
+//
+float QOLDSBuilder::samplePoint(uint32_t index, int dimension, uint32_t pixelSeed) const
+{
+  // Row-major m x m matrix of the dimension
+  const int32_t* matrix = &m_flattenedMatrices[size_t(dimension) * m_digits * m_digits];
+
+  // Samples past the net come from the next epoch
+  pixelSeed = epochSeed(pixelSeed, index / pow3Tab[m_digits]);
+
+  // Index digits, little-endian (Integer3(index))
+  int32_t i3[QOLDS_SEQUENCE_LENGTH];
+  for(int k = 0; k < QOLDS_SEQUENCE_LENGTH; k++)
+  {
+    i3[k] = int32_t(index % 3u);
+    index /= 3u;
+  }
+
+  // x3 = sum of i3[k] * column k, with column k read bottom-up (point3_digits)
+  int32_t x3[QOLDS_SEQUENCE_LENGTH] = {};
+  for(int k = 0; k < m_digits; k++)
+  {
+    for(int j = 0; j < m_digits; j++)
+    {
+      x3[j] = (x3[j] + i3[k] * matrix[(m_digits - 1 - j) * m_digits + k]) % 3;
+    }
+  }
+
+  // Per-pixel digital shift, then the Owen scrambling of the dimension
+  const uint32_t shift = digitShift(pixelSeed, dimension, m_digits);
+  for(int j = 0; j < m_digits; j++)
+  {
+    x3[j] = (x3[j] + int32_t(PackedTrits::digit(shift, uint32_t(j)))) % 3;
+  }
+
+  int32_t scrambled[QOLDS_SEQUENCE_LENGTH] = {};
+  scrambleDigits(x3, scrambled, dimension);
+
+  uint32_t value = 0;
+  for(int j = 0; j < m_digits; j++)
+  {
+    value += pow3Tab[j] * uint32_t(scrambled[j]);
+  }
+  return float(value) / float(pow3Tab[m_digits]);
+}
+
+//--------------------------------------------------------------------------------------------------
+// CPU port of the packed-trit qolds_sample(): the sum of the columns selected by the index digits
+// is computed with PackedTrits, one word per base-3 number
+//
+float QOLDSBuilder::samplePointPacked(uint32_t index, int dimension, uint32_t pixelSeed) const
+{
+  const uint32_t* columns   = &m_packedMatrices[size_t(dimension) * m_digits];
+  const uint32_t  numPoints = pow3Tab[m_digits];
+  const uint32_t  epoch     = index / numPoints;
+
+  pixelSeed = epochSeed(pixelSeed, epoch);
+
+  // Only the m digits of the index in its epoch select columns. All m columns are added, scaled by
+  // zero for the zero digits: a loop over the non-zero digits only mispredicts its exit on the CPU.
+  const uint32_t i3 = PackedTrits::fromUint(index - epoch * numPoints, uint32_t(m_digits));
+  uint32_t       x3 = 0;
+  for(uint32_t k = 0; k < uint32_t(m_digits); k++)
+  {
+    x3 = PackedTrits::fma(x3, PackedTrits::digit(i3, k), columns[k]);
+  }
+
+  x3 = PackedTrits::add(x3, digitShift(pixelSeed, dimension, m_digits));
+  return packedToFloat(scramblePacked(x3, dimension));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Gray-code stream: consecutive indices differ in one Gray digit, so the unscrambled point moves
+// by one column (point3_digits() on the changed digits only). The shader has no stream mode, it
+// is not faster once the Owen scrambling is counted (qolds_bench).
+//
+uint32_t QOLDSBuilder::sampleStream(uint32_t firstIndex, uint32_t count, int dimension, uint32_t pixelSeed, float* out) const
+{
+  const uint32_t* columns   = &m_packedMatrices[size_t(dimension) * m_digits];
+  const uint32_t  numPoints = pow3Tab[m_digits];
+  const uint32_t  mask      = (1u << m_digits) - 1u;
+
+  uint32_t g3         = 0;  // Gray code of the stream position, the point of code 0 is 0
+  uint32_t x3         = 0;
+  uint32_t columnAdds = 0;
+  for(uint32_t i = 0; i < count; i++)
+  {
+    const uint32_t index = firstIndex + i;
+    const uint32_t epoch = index / numPoints;
+    const uint32_t gray  = PackedTrits::gray(PackedTrits::fromUint(index - epoch * numPoints, QOLDS_SEQUENCE_LENGTH));
+
+    const uint32_t d3      = PackedTrits::sub(gray, g3);
+    uint32_t       changed = (d3 | (d3 >> 16u)) & mask;
+    while(changed != 0u)
+    {
+      uint32_t k = uint32_t(std::countr_zero(changed));
+      changed &= changed - 1u;
+      x3 = PackedTrits::fma(x3, PackedTrits::digit(d3, k), columns[k]);
+      columnAdds++;
+    }
+    g3 = gray;
+
+    const uint32_t shift = digitShift(epochSeed(pixelSeed, epoch), dimension, m_digits);
+    out[i]               = packedToFloat(scramblePacked(PackedTrits::add(x3, shift), dimension));
+  }
+  return columnAdds;
+}
+
+uint32_t QOLDSBuilder::grayIndex(uint32_t index) const
+{
+  const uint32_t numPoints = pow3Tab[m_digits];
+  const uint32_t epoch     = index / numPoints;
+  const uint32_t gray      = PackedTrits::gray(PackedTrits::fromUint(index - epoch * numPoints, QOLDS_SEQUENCE_LENGTH));
+  return epoch * numPoints + PackedTrits::toUint(gray, uint32_t(m_digits));
+}
+
+float QOLDSBuilder::packedToFloat(uint32_t x3) const
+{
+  uint32_t value = 0;
+  for(int j = 0; j < m_digits; j++)
+  {
+    value += pow3Tab[j] * PackedTrits::digit(x3, uint32_t(j));
+  }
+  return float(value) / float(pow3Tab[m_digits]);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Per-pixel decorrelation, identical to the shader functions
+//
+uint32_t QOLDSBuilder::pixelSeed(uint32_t x, uint32_t y)
+{
+  return fcrngHash((x & 0xFFFFu) | (y << 16u)) | 1u;
+}
+
+uint32_t QOLDSBuilder::digitShift(uint32_t pixelSeed, int dimension, int digits)
+{
+  if(pixelSeed == 0u)
+    return 0u;
+  return PackedTrits::fromUint(fcrngHash(pixelSeed ^ (uint32_t(dimension) * 0x85ebca6bu)) % pow3Tab[digits], uint32_t(digits));
+}
+
+float QOLDSBuilder::rotatePoint(float x, int dimension, uint32_t pixelSeed)
+{
+  if(pixelSeed == 0u)
+    return x;
+  float shift = float(fcrngHash(pixelSeed + uint32_t(dimension) * 0x9e3779b9u) >> 8u) * (1.0f / 16777216.0f);
+  float r     = x + shift;
+  return (r >= 1.0f) ? r - 1.0f : r;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sample budget and epochs (epochSeed() is identical to qolds_epoch_seed())
+//
+int QOLDSBuilder::digitsForSampleCount(uint64_t sampleCount)
+{
+  int digits = 1;
+  while(digits < QOLDS_SEQUENCE_LENGTH && uint64_t(pow3Tab[digits]) < sampleCount)
+    digits++;
+  return digits;
+}
+
+uint32_t QOLDSBuilder::epochSeed(uint32_t pixelSeed, uint32_t epoch)
+{
+  return (epoch == 0u) ? pixelSeed : (fcrngHash(pixelSeed ^ (epoch * 0x9e3779b9u)) | 1u);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Owen scrambling, digit for digit identical to scramble_base3()
+//
+void QOLDSBuilder::scrambleDigits(const int32_t* x3, int32_t* scrambled, int dimension) const
+{
+  // All 6 permutations of {0, 1, 2}
+  static constexpr int32_t scrambleTable[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+  uint32_t nodeIndex = 0;  // Start at the root node
+  for(int i = 0; i < m_digits; i++)
+  {
+    uint32_t flip               = treePermutation(dimension, nodeIndex);
+    int32_t  digit              = x3[m_digits - 1 - i];
+    scrambled[m_digits - 1 - i] = scrambleTable[flip][digit];
+
+    // Heap layout: root i=0, children 3*i+1, 3*i+2, 3*i+3
+    nodeIndex = 3u * nodeIndex + 1u + uint32_t(digit);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Owen scrambling of a packed word, as the packed scramble_base3()
+//
+uint32_t QOLDSBuilder::scramblePacked(uint32_t x3, int dimension) const
+{
+  static constexpr uint32_t scrambleTable[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+  uint32_t result    = 0;
+  uint32_t nodeIndex = 0;
+  for(uint32_t i = 0; i < uint32_t(m_digits); i++)
+  {
+    uint32_t j     = uint32_t(m_digits) - 1u - i;
+    uint32_t digit = PackedTrits::digit(x3, j);
+    result |= PackedTrits::fromDigit(j, scrambleTable[treePermutation(dimension, nodeIndex)][digit]);
+    nodeIndex = 3u * nodeIndex + 1u + digit;
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Permutation of a node: looked up in the first levels, hashed with the dimension seed below
+//
+uint32_t QOLDSBuilder::treePermutation(int dimension, uint32_t nodeIndex) const
+{
+  if(nodeIndex < uint32_t(QOLDS_TREE_NODES))
+  {
+    uint32_t word = m_scrambleTree[size_t(dimension) * QOLDS_TREE_WORDS + nodeIndex / QOLDS_TREE_NODES_PER_WORD];
+    return (word >> (3u * (nodeIndex % QOLDS_TREE_NODES_PER_WORD))) & 7u;
+  }
+  return nodePermutation(nodeIndex, (m_seeds[dimension] << 1u) | 1u);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Hash of the node mapped to [0, 6) by a multiply-shift on the top 16 bits (no rejection loop)
+//
+uint32_t QOLDSBuilder::nodePermutation(uint32_t nodeIndex, uint32_t key)
+{
+  return ((fcrngHash((nodeIndex + 1u) * key) >> 16u) * 6u) >> 16u;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Number of 32-bit words per dimension in the point table
+//
+uint32_t QOLDSBuilder::getPointTableStride() const
+{
+  const uint32_t numPoints = pow3Tab[m_digits];
+  return (m_tableFormat == TableFormat::eFloat32) ? numPoints : (numPoints + 1u) / 2u;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -156,27 +719,153 @@ void QOLDSBuilder::generateScrambleSeeds(uint32_t masterSeed)
 //
 int QOLDSBuilder::getMaxPoints() const
 {
-  return static_cast<int>(std::pow(3, m_digits));
+  return static_cast<int>(pow3Tab[m_digits]);
 }
 
 //--------------------------------------------------------------------------------------------------
-// Convert integer to base-3 digits
+// t-value of the net of the built dimensions
 //
-std::vector<int32_t> QOLDSBuilder::integerDigits(int32_t val, int base, int len) const
+int QOLDSBuilder::netQuality(const int* dimensions, int count, int digits) const
 {
-  std::vector<int32_t> digits;
-  for(int i = 0; i < len; i++)
+  const int32_t* matrices[QOLDS_PACKED_TRITS];
+  if(count < 1 || count > QOLDS_PACKED_TRITS || digits < 1 || digits > m_digits)
+    return -1;
+  for(int i = 0; i < count; i++)
+  {
+    matrices[i] = &m_flattenedMatrices[size_t(dimensions[i]) * m_digits * m_digits];
+  }
+  return netQuality(matrices, count, digits, m_digits);
+}
+
+//--------------------------------------------------------------------------------------------------
+// The points of an elementary interval with a_i digits fixed in dimension i are the solutions of
+// the linear system formed by the first a_i rows of every matrix: every interval of volume
+// 3^(t-m) holds 3^t points iff these m-t rows are linearly independent for every split a_i.
+//
+int QOLDSBuilder::netQuality(const int32_t* const* matrices, int count, int digits, int stride)
+{
+  int32_t rows[QOLDS_SEQUENCE_LENGTH][QOLDS_SEQUENCE_LENGTH];
+  int     split[QOLDS_PACKED_TRITS];
+
+  // Rank over GF(3) of the first a_i rows of each matrix
+  auto independent = [&](int numRows) {
+    int r = 0;
+    for(int i = 0; i < count; i++)
+    {
+      for(int row = 0; row < split[i]; row++, r++)
+      {
+        std::copy(matrices[i] + row * stride, matrices[i] + row * stride + digits, rows[r]);
+      }
+    }
+    for(int col = 0, rank = 0; rank < numRows; col++)
+    {
+      if(col == digits)
+        return false;
+      int pivot = rank;
+      while(pivot < numRows && rows[pivot][col] == 0)
+        pivot++;
+      if(pivot == numRows)
+        continue;
+      std::swap(rows[pivot], rows[rank]);
+      for(int row = rank + 1; row < numRows; row++)
+      {
+        // The inverse of 1 and 2 in GF(3) is themselves
+        const int32_t factor = (rows[row][col] * rows[rank][col]) % 3;
+        for(int k = col; k < digits; k++)
+          rows[row][k] = (rows[row][k] + 3 * 3 - factor * rows[rank][k]) % 3;
+      }
+      rank++;
+    }
+    return true;
+  };
+
+  for(int t = 0; t < digits; t++)
   {
-    digits.push_back(val % base);
-    val = val / base;
+    // Every split of the m-t digits over the dimensions
+    const int numRows = digits - t;
+    bool      isNet   = true;
+    std::fill(split, split + count, 0);
+    split[count - 1] = numRows;
+    while(isNet)
+    {
+      isNet = independent(numRows);
+
+      // Next composition of numRows in count parts
+      int i = count - 1;
+      while(i > 0 && split[i] == 0)
+        i--;
+      if(i == 0)
+        break;
+      split[i - 1]++;
+      const int rest = split[i] - 1;
+      split[i]       = 0;
+      split[count - 1] = rest;
+    }
+    if(isNet)
+      return t;
   }
   return digits;
 }
 
 //--------------------------------------------------------------------------------------------------
-// Convert base-3 digits back to integer
+// Monic irreducible polynomials over GF(3): no monic factor of degree up to half of theirs
+//
+std::vector<int32_t> QOLDSBuilder::irreduciblePolynomials(int maxDegree)
+{
+  // Remainder of p (digits of increasing degree) divided by the monic q, in place
+  auto remainderIsZero = [](int32_t* p, int degreeP, const int32_t* q, int degreeQ) {
+    for(int i = degreeP; i >= degreeQ; i--)
+    {
+      const int32_t factor = p[i];
+      for(int k = 0; k <= degreeQ; k++)
+        p[i - degreeQ + k] = (p[i - degreeQ + k] + 3 * 3 - factor * q[k]) % 3;
+    }
+    for(int i = 0; i < degreeQ; i++)
+      if(p[i] != 0)
+        return false;
+    return true;
+  };
+
+  std::vector<int32_t> polynomials;
+  for(int degree = 1; degree <= maxDegree; degree++)
+  {
+    for(int32_t a = int32_t(pow3Tab[degree]); a < int32_t(2 * pow3Tab[degree]); a++)
+    {
+      int32_t p[QOLDS_SEQUENCE_LENGTH];
+      bool    irreducible = true;
+      for(int degreeQ = 1; irreducible && degreeQ <= degree / 2; degreeQ++)
+      {
+        for(int32_t b = int32_t(pow3Tab[degreeQ]); irreducible && b < int32_t(2 * pow3Tab[degreeQ]); b++)
+        {
+          int32_t q[QOLDS_SEQUENCE_LENGTH];
+          integerDigits(a, 3, degree + 1, p);
+          integerDigits(b, 3, degreeQ + 1, q);
+          irreducible = !remainderIsZero(p, degree, q, degreeQ);
+        }
+      }
+      if(irreducible)
+        polynomials.push_back(a);
+    }
+  }
+  return polynomials;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Convert integer to base-N digits
 //
-int32_t QOLDSBuilder::fromDigits(const std::vector<int32_t>& digits, int base, int len) const
+void QOLDSBuilder::integerDigits(int32_t val, int base, int len, int32_t* digits)
+{
+  for(int i = 0; i < len; i++)
+  {
+    digits[i] = val % base;
+    val       = val / base;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Convert base-N digits back to integer
+//
+int32_t QOLDSBuilder::fromDigits(const int32_t* digits, int base, int len)
 {
   int32_t pow = 1, res = 0;
   for(int i = 0; i < len; i++)
@@ -190,9 +879,10 @@ int32_t QOLDSBuilder::fromDigits(const std::vector<int32_t>& digits, int base, i
 //--------------------------------------------------------------------------------------------------
 // Multiply by factor in GF(N)
 //
-int32_t QOLDSBuilder::multiplyByFactorInGFN(int32_t x, int32_t factor, int base, int len) const
+int32_t QOLDSBuilder::multiplyByFactorInGFN(int32_t x, int32_t factor, int base, int len)
 {
-  std::vector<int32_t> digits = integerDigits(x, base, len);
+  int32_t digits[QOLDS_SEQUENCE_LENGTH];
+  integerDigits(x, base, len, digits);
   for(int i = 0; i < len; i++)
   {
     digits[i] = (digits[i] * factor) % base;
@@ -201,43 +891,25 @@ int32_t QOLDSBuilder::multiplyByFactorInGFN(int32_t x, int32_t factor, int base,
 }
 
 //--------------------------------------------------------------------------------------------------
-// XOR operation in GF(N)
+// XOR operation in GF(N): digit-wise sum modulo N
 //
-int32_t QOLDSBuilder::bitXorGFN(int base, const std::vector<int32_t>& lst, int len, int polynomialDegree) const
+int32_t QOLDSBuilder::bitXorGFN(int base, const int32_t* lst, int len, int polynomialDegree)
 {
-  int32_t digits[QOLDS_SEQUENCE_LENGTH][QOLDS_SEQUENCE_LENGTH];
-
-  // Initialize to zero
-  for(int i = 0; i < QOLDS_SEQUENCE_LENGTH; i++)
+  int32_t finalDigits[QOLDS_SEQUENCE_LENGTH] = {};
+  int32_t digits[QOLDS_SEQUENCE_LENGTH];
+  for(int j = 0; j <= polynomialDegree; j++)
   {
-    for(int j = 0; j < QOLDS_SEQUENCE_LENGTH; j++)
+    integerDigits(lst[j], base, len, digits);
+    for(int i = 0; i < len; i++)
     {
-      digits[i][j] = 0;
+      finalDigits[i] += digits[i];
     }
   }
 
-  // Convert list elements to digits
-  for(int i = 0; i <= polynomialDegree; i++)
-  {
-    std::vector<int32_t> d = integerDigits(lst[i], base, len);
-    for(int j = 0; j < len; j++)
-    {
-      digits[i][j] = d[j];
-    }
-  }
-
-  // XOR digits
-  std::vector<int32_t> finalDigits(QOLDS_SEQUENCE_LENGTH + 1, 0);
   for(int i = 0; i < len; i++)
   {
-    finalDigits[i] = 0;
-    for(int j = 0; j <= polynomialDegree; j++)
-    {
-      finalDigits[i] += digits[j][i];
-    }
     finalDigits[i] = finalDigits[i] % base;
   }
-
   return fromDigits(finalDigits, base, len);
 }
 
@@ -246,19 +918,18 @@ int32_t QOLDSBuilder::bitXorGFN(int base, const std::vector<int32_t>& lst, int l
 //
 void QOLDSBuilder::generateMkGF3(int32_t ipolynomial, int32_t polynomialDegree, int32_t* msobol, int base)
 {
-  std::vector<int32_t> polynomial = integerDigits(ipolynomial, base, polynomialDegree + 1);
+  int32_t polynomial[QOLDS_SEQUENCE_LENGTH];
+  integerDigits(ipolynomial, base, polynomialDegree + 1, polynomial);
 
   for(int i = polynomialDegree + 1; i <= QOLDS_SEQUENCE_LENGTH; i++)
   {
-    std::vector<int32_t> lst;
-    lst.push_back(msobol[i - polynomialDegree - 1]);
+    int32_t lst[QOLDS_SEQUENCE_LENGTH];
+    lst[0] = msobol[i - polynomialDegree - 1];
 
     for(int j = 1; j < polynomialDegree + 1; j++)
     {
-      lst.push_back(pow3Tab[j] * multiplyByFactorInGFN(msobol[i - j - 1],
-                                                        convertToGF3[polynomial[polynomialDegree - j]],
-                                                        base,
-                                                        QOLDS_SEQUENCE_LENGTH));
+      lst[j] = pow3Tab[j] * multiplyByFactorInGFN(msobol[i - j - 1], convertToGF3[polynomial[polynomialDegree - j]], base,
+                                                  QOLDS_SEQUENCE_LENGTH);
     }
 
     msobol[i - 1] = bitXorGFN(base, lst, i, polynomialDegree);
@@ -268,14 +939,15 @@ void QOLDSBuilder::generateMkGF3(int32_t ipolynomial, int32_t polynomialDegree,
 //--------------------------------------------------------------------------------------------------
 // Fill matrix from sobol_mk data
 //
-void QOLDSBuilder::fillMatrix(int sobolMkIndex, std::vector<std::vector<int32_t>>& matrix)
+void QOLDSBuilder::fillMatrix(int sobolMkIndex, int32_t (&matrix)[QOLDS_SEQUENCE_LENGTH][QOLDS_SEQUENCE_LENGTH]) const
 {
-  for(int i = 0; i < QOLDS_MATRIX_SIZE; i++)
+  for(int i = 0; i < QOLDS_SEQUENCE_LENGTH; i++)
   {
     int32_t val = m_sobol_mk[sobolMkIndex][i];
     int     len = i + 1;
 
-    std::vector<int32_t> digits = integerDigits(val, 3, len);
+    int32_t digits[QOLDS_SEQUENCE_LENGTH];
+    integerDigits(val, 3, len, digits);
     for(int j = 0; j < len; j++)
     {
       matrix[len - j - 1][i] = digits[j];
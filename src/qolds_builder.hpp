@@ -23,13 +23,80 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <iosfwd>
 
 //--------------------------------------------------------------------------------------------------
 // Constants
 //
-constexpr int QOLDS_MAX_DIMENSIONS = 48;    // Maximum supported dimensions
+constexpr int QOLDS_MAX_DIMENSIONS = 256;   // Maximum supported dimensions (slot 0 unused): 48 from the .dat file, the rest searched
 constexpr int QOLDS_SEQUENCE_LENGTH = 10;  // 3^10 = 59049 max points
-constexpr int QOLDS_MATRIX_SIZE = 20;      // Matrix size for generation
+constexpr int QOLDS_PACKED_TRITS = 16;     // Trits per bit-plane in a packed word
+
+// Search of the dimensions past initIrreducibleGF3.dat (extendInitData)
+constexpr int QOLDS_SEARCH_CANDIDATES = 32;  // Random direction number sets tried per dimension
+constexpr int QOLDS_SEARCH_WINDOW     = 8;   // Previous dimensions whose 2D projections are scored
+
+// Owen scramble tree: the permutations of the first levels of the base-3 tree are precomputed
+constexpr int QOLDS_TREE_LEVELS         = 6;    // Levels in the table (the deeper ones are hashed)
+constexpr int QOLDS_TREE_NODES          = 364;  // (3^6 - 1) / 2 nodes in the first 6 levels
+constexpr int QOLDS_TREE_NODES_PER_WORD = 10;   // 3-bit permutation indices per 32-bit word
+constexpr int QOLDS_TREE_WORDS          = 37;   // Words per dimension
+
+//--------------------------------------------------------------------------------------------------
+// PackedTrits: Bit-sliced GF(3) vectors, identical to Integer3 in qolds_sampling.h.slang
+//
+// A 32-bit word holds up to 16 base-3 digits in two bit-planes:
+// bit j is set if digit j == 1, bit 16+j is set if digit j == 2 (never both).
+// Addition, negation and scaling act on all digits at once with a few bitwise operations.
+//
+struct PackedTrits
+{
+  // Exchange the two bit-planes, which negates every digit (-1 == 2 mod 3)
+  static constexpr uint32_t swap(uint32_t a) { return (a >> 16u) | (a << 16u); }
+
+  // Digit-wise (a + b) mod 3
+  static constexpr uint32_t add(uint32_t a, uint32_t b)
+  {
+    uint32_t t = (a | swap(b)) ^ (swap(a) | b);
+    return swap(a | b) ^ t;
+  }
+
+  // Digit-wise (a - b) mod 3
+  static constexpr uint32_t sub(uint32_t a, uint32_t b) { return add(a, swap(b)); }
+
+  // Digit-wise (d * b) mod 3 for a scalar d in {0, 1, 2}, with masks: the digits are random, a branch mispredicts
+  static constexpr uint32_t scale(uint32_t d, uint32_t b) { return (b & (0u - (d & 1u))) | (swap(b) & (0u - (d >> 1u))); }
+
+  // Digit-wise (a + d * b) mod 3
+  static constexpr uint32_t fma(uint32_t a, uint32_t d, uint32_t b) { return add(a, scale(d, b)); }
+
+  // Digit j in {0, 1, 2}
+  static constexpr uint32_t digit(uint32_t a, uint32_t j) { return ((a >> j) & 1u) | (((a >> (16u + j)) & 1u) << 1u); }
+
+  // Word with the single digit j set to d
+  static constexpr uint32_t fromDigit(uint32_t j, uint32_t d) { return ((d & 1u) << j) | ((d >> 1u) << (16u + j)); }
+
+  // Modular Gray code, digit i = (a_i - a_{i+1}) mod 3 (graycode() in the shader)
+  static constexpr uint32_t gray(uint32_t a) { return sub(a, (a >> 1u) & 0x7FFF7FFFu); }
+
+  // Integer value of the first n digits
+  static constexpr uint32_t toUint(uint32_t a, uint32_t n = QOLDS_PACKED_TRITS)
+  {
+    uint32_t x = 0;
+    for(uint32_t j = n; j-- > 0u;)
+      x = x * 3u + digit(a, j);
+    return x;
+  }
+
+  // Pack the first n base-3 digits of x (little-endian)
+  static constexpr uint32_t fromUint(uint32_t x, uint32_t n = QOLDS_PACKED_TRITS)
+  {
+    uint32_t a = 0;
+    for(uint32_t j = 0; j < n; j++, x /= 3u)
+      a |= fromDigit(j, x % 3u);
+    return a;
+  }
+};
 
 //--------------------------------------------------------------------------------------------------
 // QOLDSBuilder: Host-side generator for QOLDS sampling matrices
@@ -40,6 +107,13 @@ constexpr int QOLDS_MATRIX_SIZE = 20;      // Matrix size for generation
 class QOLDSBuilder
 {
 public:
+  // Storage format of the precomputed point table
+  enum class TableFormat
+  {
+    eFloat32,  // One 32-bit float per point
+    eUnorm16,  // Two 16-bit unorm values per 32-bit word (value / 65536, stays in [0, 1))
+  };
+
   QOLDSBuilder() = default;
   ~QOLDSBuilder() = default;
 
@@ -47,25 +121,119 @@ public:
   // Returns true on success, false on failure
   bool loadInitData(const std::string& filepath);
 
+  // Fill the initialization data from the compile-time copy of initIrreducibleGF3.dat (qolds_matrices.hpp)
+  void loadBakedInitData();
+
+  // Extend the initialization data to D dimensions (up to QOLDS_MAX_DIMENSIONS-1). Every new dimension
+  // takes the next irreducible polynomial over GF(3) not used yet, and the direction numbers, among
+  // QOLDS_SEARCH_CANDIDATES random sets, whose 2D projections with the QOLDS_SEARCH_WINDOW previous
+  // dimensions have the lowest t-values. The search is deterministic; its result is cached in
+  // cachePath (initIrreducibleGF3.dat format, reused while it starts with the current data), empty for no cache.
+  // Returns false if D is out of range.
+  bool extendInitData(int dimensions, const std::string& cachePath);
+
   // Build generator matrices for D dimensions using m digits (3^m points)
-  // D: number of dimensions (1-48)
+  // The dimensions are built in parallel, on fixed-size arrays (no allocation besides the output)
+  // D: number of dimensions (1 .. getInitDimensions())
   // m: number of base-3 digits (1-10, produces 3^m points)
   void buildMatrices(int dimensions, int digits);
 
-  // Generate random scrambling seeds for Owen scrambling
+  // Same matrices, copied from the compile-time tables of qolds_matrices.hpp (baked from
+  // initIrreducibleGF3.dat at build time): no file I/O and no loadInitData() needed
+  // D: number of dimensions (1-47)
+  void buildBakedMatrices(int dimensions, int digits);
+
+  // Generate random scrambling seeds for Owen scrambling, and the scramble tree of every dimension:
+  // the permutation indices of the first QOLDS_TREE_LEVELS levels, looked up instead of hashed
   // masterSeed: seed for random number generator (0 = use random device)
   void generateScrambleSeeds(uint32_t masterSeed = 0);
 
+  // Fresh scrambling for a new render job: regenerates the seeds and scramble trees in place, the
+  // matrices are untouched. No allocation and no logging once generateScrambleSeeds() sized the
+  // buffers, a few microseconds for 47 dimensions. The point table must be rebuilt afterwards.
+  void rescramble(uint32_t masterSeed);
+
+  // Build the scrambled point table [D][3^m] for table-driven sampling on the GPU
+  // Requires buildMatrices() and generateScrambleSeeds() to be called first
+  void buildPointTable(TableFormat format);
+
+  // CPU reference of qolds_sample() in qolds_sampling.h.slang: same digits, same scrambling
+  // index: sample index, past 3^m the points come from independently scrambled epochs (epochSeed())
+  // pixelSeed: pixelSeed() of the pixel, 0 for the sequence shared by all pixels
+  float samplePoint(uint32_t index, int dimension, uint32_t pixelSeed = 0) const;
+
+  // Same point computed with the packed-trit arithmetic of the shader (bit-exact with samplePoint)
+  float samplePointPacked(uint32_t index, int dimension, uint32_t pixelSeed = 0) const;
+
+  // Incremental Gray-code order (qolds_bench only): the points of indices [firstIndex, firstIndex + count)
+  // of one dimension in Gray-code order, stepping the cached point by one column add per index.
+  // out[i] is bit-exact with samplePoint(grayIndex(firstIndex + i), dimension, pixelSeed).
+  // Returns the number of generator columns added, for cost comparisons.
+  uint32_t sampleStream(uint32_t firstIndex, uint32_t count, int dimension, uint32_t pixelSeed, float* out) const;
+
+  // Index in the natural order of the point visited at `index` in Gray-code order (same epoch)
+  uint32_t grayIndex(uint32_t index) const;
+
+  //--------------------------------------------------------------------------------------------------
+  // Per-pixel decorrelation (qolds_pixel_seed, qolds_digit_shift and qolds_rotate in the shader)
+  //
+  // Decorrelation seed of a pixel, never 0
+  static uint32_t pixelSeed(uint32_t x, uint32_t y);
+
+  // Random digital shift (packed trits) of a dimension for a pixel, added before the Owen scrambling
+  static uint32_t digitShift(uint32_t pixelSeed, int dimension, int digits);
+
+  // Cranley-Patterson rotation of a table point for a pixel
+  static float rotatePoint(float x, int dimension, uint32_t pixelSeed);
+
+  //--------------------------------------------------------------------------------------------------
+  // Sample budget (qolds_epoch_seed in the shader)
+  //
+  // Smallest m whose 3^m points cover sampleCount samples, clamped to [1, QOLDS_SEQUENCE_LENGTH]
+  static int digitsForSampleCount(uint64_t sampleCount);
+
+  // Decorrelation seed of epoch e = index / 3^m: epoch 0 is the pixel's own sequence, every later
+  // epoch replays the net with an independent scrambling (or rotation) instead of repeating points
+  static uint32_t epochSeed(uint32_t pixelSeed, uint32_t epoch);
+
   // Get the flattened matrix data for GPU upload
   // Returns: matrices in row-major order [D][m][m]
   const std::vector<int32_t>& getMatrixData() const { return m_flattenedMatrices; }
 
+  // Get the packed matrix data for GPU upload
+  // Returns: one PackedTrits word per column [D][m], trit j of column k holds matrix[m-1-j][k]
+  const std::vector<uint32_t>& getPackedMatrixData() const { return m_packedMatrices; }
+
   // Get scrambling seeds (one per dimension)
   const std::vector<uint32_t>& getScrambleSeeds() const { return m_seeds; }
 
+  // Get the scramble tree for GPU upload: [D][QOLDS_TREE_WORDS], node n of a dimension in
+  // bits 3*(n%10) of word n/10, holding the index of its permutation of {0, 1, 2}
+  const std::vector<uint32_t>& getScrambleTreeData() const { return m_scrambleTree; }
+
+  // Get the point table for GPU upload: [D][getPointTableStride()] 32-bit words
+  const std::vector<uint32_t>& getPointTableData() const { return m_pointTable; }
+
+  // Format of the point table built by buildPointTable()
+  TableFormat getPointTableFormat() const { return m_tableFormat; }
+
+  // Number of 32-bit words per dimension in the point table
+  uint32_t getPointTableStride() const;
+
   // Get the number of dimensions
   int getDimensions() const { return m_dimensions; }
 
+  // Number of dimensions of the initialization data (loaded, baked or extended)
+  int getInitDimensions() const { return m_initDimensions; }
+
+  // Number of dimensions of buildBakedMatrices()
+  static int getBakedDimensions();
+
+  // t of the (t,m,s)-net formed by the 3^m unscrambled points of the given (built) dimensions: every
+  // elementary interval of volume 3^(t-m) holds 3^t points, t = 0 is a perfectly stratified net.
+  // Owen scrambling and digital shifts keep t. digits: m, at most getDigits().
+  int netQuality(const int* dimensions, int count, int digits) const;
+
   // Get the number of digits (m, where 3^m = max points)
   int getDigits() const { return m_digits; }
 
@@ -76,17 +244,17 @@ private:
   //--------------------------------------------------------------------------------------------------
   // Base-3 arithmetic utilities
   //
-  // Convert integer to base-3 digits
-  std::vector<int32_t> integerDigits(int32_t val, int base, int len) const;
+  // Convert integer to its first len base-N digits (little-endian), digits[len] must be valid
+  static void integerDigits(int32_t val, int base, int len, int32_t* digits);
 
-  // Convert base-3 digits back to integer
-  int32_t fromDigits(const std::vector<int32_t>& digits, int base, int len) const;
+  // Convert base-N digits back to integer
+  static int32_t fromDigits(const int32_t* digits, int base, int len);
 
   // Multiply by factor in GF(N)
-  int32_t multiplyByFactorInGFN(int32_t x, int32_t factor, int base, int len) const;
+  static int32_t multiplyByFactorInGFN(int32_t x, int32_t factor, int base, int len);
 
-  // XOR operation in GF(N)
-  int32_t bitXorGFN(int base, const std::vector<int32_t>& lst, int len, int polynomialDegree) const;
+  // XOR operation in GF(N) of lst[0 .. polynomialDegree]
+  static int32_t bitXorGFN(int base, const int32_t* lst, int len, int polynomialDegree);
 
   //--------------------------------------------------------------------------------------------------
   // Sobol' matrix generation
@@ -95,26 +263,64 @@ private:
   void generateMkGF3(int32_t ipolynomial, int32_t polynomialDegree, int32_t* msobol, int base);
 
   // Fill matrix from sobol_mk data
-  void fillMatrix(int sobolMkIndex, std::vector<std::vector<int32_t>>& matrix);
+  void fillMatrix(int sobolMkIndex, int32_t (&matrix)[QOLDS_SEQUENCE_LENGTH][QOLDS_SEQUENCE_LENGTH]) const;
+
+  // Monic irreducible polynomials over GF(3) of degree 1 .. maxDegree, encoded as the base-3 digits of
+  // `a` in initIrreducibleGF3.dat, in increasing order (the `d` column is the rank in this list)
+  static std::vector<int32_t> irreduciblePolynomials(int maxDegree);
+
+  // t-value of the net of `count` matrices (row-major, rows of `stride` trits) for m digits
+  static int netQuality(const int32_t* const* matrices, int count, int digits, int stride);
+
+  // Parse the rows of an initialization file into the slots 1, 2, ..., returns the number of dimensions
+  int readInitData(std::istream& file);
+
+  // Read / write the extended initialization data
+  bool loadInitCache(const std::string& cachePath, int dimensions);
+  void saveInitCache(const std::string& cachePath) const;
+
+  //--------------------------------------------------------------------------------------------------
+  // Owen scrambling (CPU port of scramble_base3)
+  //
+  // Permute the m digits of x3 (little-endian) using the permutation tree of the dimension
+  void scrambleDigits(const int32_t* x3, int32_t* scrambled, int dimension) const;
+
+  // Same permutation on a packed word (port of the packed scramble_base3)
+  uint32_t scramblePacked(uint32_t x3, int dimension) const;
+
+  // Permutation of a tree node of a dimension: table for the first levels, hash below
+  uint32_t treePermutation(int dimension, uint32_t nodeIndex) const;
+
+  // Float in [0, 1) of the first m digits of a packed point (Integer3::toDouble)
+  float packedToFloat(uint32_t x3) const;
+
+  // Hashed permutation of a tree node, qolds_node_permutation() in the shader
+  static uint32_t nodePermutation(uint32_t nodeIndex, uint32_t key);
 
   //--------------------------------------------------------------------------------------------------
   // Member variables
   //
-  int m_dimensions{0};  // Number of dimensions
-  int m_digits{0};      // Number of base-3 digits (m)
+  int m_dimensions{0};      // Number of dimensions
+  int m_digits{0};          // Number of base-3 digits (m)
+  int m_initDimensions{0};  // Number of dimensions of the initialization data
 
-  // Sobol' initialization data (loaded from .dat file)
-  int32_t m_sobol_dj[QOLDS_MAX_DIMENSIONS];        // Polynomial degrees
-  int32_t m_sobol_sj[QOLDS_MAX_DIMENSIONS];        // Number of direction numbers
-  int32_t m_sobol_aj[QOLDS_MAX_DIMENSIONS];        // Irreducible polynomial coefficients
-  int32_t m_sobol_mk[QOLDS_MAX_DIMENSIONS][32];    // Direction numbers
+  // Sobol' initialization data (loaded from .dat file, then extended), slots 1 .. m_initDimensions
+  int32_t m_sobol_dj[QOLDS_MAX_DIMENSIONS];                         // Rank of the polynomial among the irreducible ones
+  int32_t m_sobol_sj[QOLDS_MAX_DIMENSIONS];                         // Polynomial degree (number of initial direction numbers)
+  int32_t m_sobol_aj[QOLDS_MAX_DIMENSIONS];                         // Irreducible polynomial coefficients
+  int32_t m_sobol_mk[QOLDS_MAX_DIMENSIONS][QOLDS_SEQUENCE_LENGTH];  // Direction numbers
 
   // Generated matrices (one per dimension)
-  std::vector<std::vector<std::vector<int32_t>>> m_matrices;  // [D][m][m]
-  std::vector<int32_t>                           m_flattenedMatrices;  // Flattened for GPU upload
+  std::vector<int32_t>  m_flattenedMatrices;  // Flattened [D][m][m], one trit per int
+  std::vector<uint32_t> m_packedMatrices;     // Packed columns [D][m] for GPU upload
 
-  // Owen scrambling seeds (one per dimension)
+  // Owen scrambling seeds (one per dimension) and their precomputed tree levels
   std::vector<uint32_t> m_seeds;
+  std::vector<uint32_t> m_scrambleTree;  // [D][QOLDS_TREE_WORDS]
+
+  // Precomputed scrambled points (see buildPointTable)
+  std::vector<uint32_t> m_pointTable;
+  TableFormat           m_tableFormat{TableFormat::eFloat32};
 
   // Power of 3 lookup table
   static constexpr uint32_t pow3Tab[21] = {1, 3, 9, 27, 81, 243, 729, 2187, 6561, 19683, 59049,
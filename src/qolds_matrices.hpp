@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "qolds_builder.hpp"
+#include "qolds_init_data.h"  // Generated by cmake/qolds_init_data.cmake from resources/initIrreducibleGF3.dat
+
+//--------------------------------------------------------------------------------------------------
+// Compile-time QOLDS generator matrices
+//
+// constexpr port of QOLDSBuilder::generateMkGF3() and fillMatrix(): the Sobol' matrices of the
+// dimensions in initIrreducibleGF3.dat are computed by the compiler, for all m up to
+// QOLDS_SEQUENCE_LENGTH, and QOLDSBuilder::buildBakedMatrices() only copies them.
+// qolds_bench checks them against the runtime builder.
+//
+namespace qolds {
+
+// One line of initIrreducibleGF3.dat
+struct InitRow
+{
+  int32_t d;      // Polynomial index
+  int32_t s;      // Polynomial degree (number of initial direction numbers)
+  int32_t a;      // Irreducible polynomial, base-3 coefficients
+  int32_t m[32];  // Initial direction numbers m_1 .. m_s
+};
+
+inline constexpr InitRow kInitData[] = {QOLDS_INIT_DATA};
+
+// Same dimensions as QOLDSBuilder::loadInitData(), which fills the slots 1 .. QOLDS_MAX_DIMENSIONS-1
+inline constexpr int kBakedDimensions = (QOLDS_INIT_DIMENSIONS < QOLDS_MAX_DIMENSIONS - 1) ? QOLDS_INIT_DIMENSIONS :
+                                                                                             QOLDS_MAX_DIMENSIONS - 1;
+inline constexpr int kBakedDigits = QOLDS_SEQUENCE_LENGTH;
+
+using Matrix = std::array<std::array<int8_t, kBakedDigits>, kBakedDigits>;  // [row][column]
+
+namespace detail {
+
+// Digit i of x in base 3
+constexpr int32_t digit3(int32_t x, int i)
+{
+  for(int k = 0; k < i; k++)
+    x /= 3;
+  return x % 3;
+}
+
+// Digit-wise sum in GF(3) of the first len digits of values[0 .. count)
+constexpr int32_t addGF3(const int32_t* values, int count, int len)
+{
+  int32_t result = 0;
+  for(int i = len - 1; i >= 0; i--)
+  {
+    int32_t sum = 0;
+    for(int j = 0; j < count; j++)
+      sum += digit3(values[j], i);
+    result = result * 3 + sum % 3;
+  }
+  return result;
+}
+
+// Digit-wise product in GF(3) of the first len digits of x by factor
+constexpr int32_t scaleGF3(int32_t x, int32_t factor, int len)
+{
+  int32_t result = 0;
+  for(int i = len - 1; i >= 0; i--)
+    result = result * 3 + (digit3(x, i) * factor) % 3;
+  return result;
+}
+
+// Direction numbers m_1 .. m_10 of a dimension (generateMkGF3)
+constexpr std::array<int32_t, kBakedDigits> generateMk(const InitRow& row)
+{
+  constexpr int32_t convertToGF3[3] = {0, 2, 1};
+  constexpr int32_t pow3[8]         = {1, 3, 9, 27, 81, 243, 729, 2187};
+
+  std::array<int32_t, kBakedDigits> mk{};
+  for(int i = 0; i < row.s && i < kBakedDigits; i++)
+    mk[i] = row.m[i];
+
+  for(int i = row.s + 1; i <= kBakedDigits; i++)
+  {
+    int32_t lst[8]{};
+    lst[0] = mk[i - row.s - 1];
+    for(int j = 1; j < row.s + 1; j++)
+      lst[j] = pow3[j] * scaleGF3(mk[i - j - 1], convertToGF3[digit3(row.a, row.s - j)], kBakedDigits);
+    mk[i - 1] = addGF3(lst, row.s + 1, i);
+  }
+  return mk;
+}
+
+// Generator matrix of a dimension: column i holds the i+1 digits of m_i+1, most significant on top (fillMatrix)
+constexpr Matrix generateMatrix(const InitRow& row)
+{
+  const std::array<int32_t, kBakedDigits> mk = generateMk(row);
+
+  Matrix matrix{};
+  for(int i = 0; i < kBakedDigits; i++)
+  {
+    const int len = i + 1;
+    for(int j = 0; j < len; j++)
+      matrix[len - j - 1][i] = int8_t(digit3(mk[i], j));
+  }
+  return matrix;
+}
+
+}  // namespace detail
+
+// The full (m = QOLDS_SEQUENCE_LENGTH) matrices; the m x m matrix is the top-left corner
+inline constexpr std::array<Matrix, kBakedDimensions> kBakedMatrices = [] {
+  std::array<Matrix, kBakedDimensions> matrices{};
+  for(int d = 0; d < kBakedDimensions; d++)
+    matrices[d] = detail::generateMatrix(kInitData[d]);
+  return matrices;
+}();
+
+// Packed column k of dimension d for m digits (QOLDSBuilder::getPackedMatrixData())
+constexpr uint32_t packedColumn(int d, int m, int k)
+{
+  uint32_t column = 0;
+  for(int j = 0; j < m; j++)
+    column |= PackedTrits::fromDigit(uint32_t(j), uint32_t(kBakedMatrices[d][m - 1 - j][k]));
+  return column;
+}
+
+// Sobol' matrices are upper triangular with a non-zero diagonal (they must be invertible)
+constexpr bool isUpperTriangular()
+{
+  for(const Matrix& matrix : kBakedMatrices)
+    for(int row = 0; row < kBakedDigits; row++)
+      for(int col = 0; col <= row; col++)
+        if((col < row && matrix[row][col] != 0) || (col == row && matrix[row][col] == 0))
+          return false;
+  return true;
+}
+static_assert(isUpperTriangular(), "QOLDS: baked generator matrices must be upper triangular and invertible");
+
+}  // namespace qolds
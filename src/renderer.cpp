@@ -350,6 +350,8 @@ void GltfRenderer::onRender(VkCommandBuffer cmd)
         .infinitePlaneBaseColor = m_resources.settings.infinitePlaneBaseColor,
         .infinitePlaneMetallic  = m_resources.settings.infinitePlaneMetallic,
         .infinitePlaneRoughness = m_resources.settings.infinitePlaneRoughness,
+        .lightSelectProbability    = getLightSelectProbability(),
+        .emissiveSelectProbability = getEmissiveSelectProbability(),
     };
     // Update the camera information
     m_prevMVP = finfo.viewProjMatrix;
@@ -378,6 +380,8 @@ void GltfRenderer::onRender(VkCommandBuffer cmd)
     if(!m_cpuTimePrinted)
     {
       LOGI("Rendering finished: %f ms\n", m_cpuTimer.getMilliseconds());
+      if(m_resources.settings.renderSystem == RenderingMode::ePathtracer)
+        m_pathTracer.logPerformance();
       m_cpuTimePrinted = true;
     }
   }
@@ -399,6 +403,9 @@ void GltfRenderer::onUIMenu()
 // Called with headless rendering, to save the final image
 void GltfRenderer::onLastHeadlessFrame()
 {
+  // Logged once: here only when the render did not reach maxFrames
+  if(!m_cpuTimePrinted && m_resources.settings.renderSystem == RenderingMode::ePathtracer)
+    m_pathTracer.logPerformance();
   m_app->saveImageToFile(m_resources.gBuffers.getColorImage(Resources::eImgTonemapped), m_resources.gBuffers.getSize(),
                          nvutils::getExecutablePath().replace_extension(".jpg").string());
 }
@@ -645,44 +652,56 @@ void GltfRenderer::createVulkanScene()
   // Build mapping for faster node lookups
   updateNodeToRenderNodeMap();
 
-  // Initialize QOLDS sampling
+  // Initialize QOLDS and Sobol'-Owen sampling
   createQoldsBuffers();
+  createSobolBuffers();
+
+  // Power-weighted light selection, light BVH and emissive triangles
+  createLightSamplingBuffers();
 }
 
 //--------------------------------------------------------------------------------------------------
 // Create and upload QOLDS sampling buffers
 void GltfRenderer::createQoldsBuffers()
 {
-  // Initialize QOLDS builder
-  m_qoldsBuilder = std::make_unique<QOLDSBuilder>();
-
-  // Load irreducible polynomials using proper path resolution
-  std::filesystem::path qoldsDataPath = nvutils::findFile("initIrreducibleGF3.dat", nvsamples::getResourcesDirs(), false);
-  if(qoldsDataPath.empty())
+  if(!m_qoldsBuilder)
+    m_qoldsBuilder = std::make_unique<QOLDSBuilder>();
+
+  // Matrices: m digits so that the 3^m points cover the sample budget of the render, and at least the
+  // dimensions of a path of maxDepth bounces. The ones of initIrreducibleGF3.dat are computed at compile
+  // time (qolds_matrices.hpp); deeper paths extend them with searched dimensions, cached next to the executable.
+  const uint64_t sampleBudget = m_pathTracer.getSampleBudget(m_resources);
+  const int      digits       = QOLDSBuilder::digitsForSampleCount(sampleBudget);
+  const int      dimensions   = std::min(m_pathTracer.getSampleDimensions(), QOLDS_MAX_DIMENSIONS - 1);
+  if(dimensions <= QOLDSBuilder::getBakedDimensions())
   {
-    // Fallback: try relative to executable
-    qoldsDataPath = nvutils::getExecutablePath().parent_path() / "resources" / "initIrreducibleGF3.dat";
+    m_qoldsBuilder->buildBakedMatrices(QOLDSBuilder::getBakedDimensions(), digits);
   }
-
-  if(!m_qoldsBuilder->loadInitData(qoldsDataPath.string()))
+  else
   {
-    LOGE("Failed to load QOLDS initialization data from: %s\n", qoldsDataPath.string().c_str());
-    return;
+    const std::filesystem::path cachePath = nvutils::getExecutablePath().parent_path() / "qolds_init_cache.dat";
+    if(m_qoldsBuilder->getInitDimensions() == 0)
+      m_qoldsBuilder->loadBakedInitData();
+    m_qoldsBuilder->extendInitData(dimensions, cachePath.string());
+    m_qoldsBuilder->buildMatrices(dimensions, digits);
   }
 
-  // Build matrices: 47 dimensions, m=5 (243 max points)
-  // Note: The initIrreducibleGF3.dat file contains data for 47 dimensions (1-47)
-  m_qoldsBuilder->buildMatrices(47, 5);
-
   // Generate scrambling seeds (use fixed seed for reproducibility, or 0 for random)
   m_qoldsBuilder->generateScrambleSeeds(0);
 
   // Get data for GPU upload
-  const auto& matrices = m_qoldsBuilder->getMatrixData();
+  const auto& matrices = m_qoldsBuilder->getPackedMatrixData();
   const auto& seeds    = m_qoldsBuilder->getScrambleSeeds();
+  const auto& tree     = m_qoldsBuilder->getScrambleTreeData();
+
+  // Release the buffers of a previously loaded scene
+  m_resources.allocator.destroyBuffer(m_resources.bQoldsMatrices);
+  m_resources.allocator.destroyBuffer(m_resources.bQoldsSeeds);
+  m_resources.allocator.destroyBuffer(m_resources.bQoldsTable);
+  m_resources.allocator.destroyBuffer(m_resources.bQoldsScrambleTree);
 
-  // Create matrices buffer
-  VkDeviceSize matrixSize = matrices.size() * sizeof(int32_t);
+  // Create matrices buffer (one packed word per column)
+  VkDeviceSize matrixSize = matrices.size() * sizeof(uint32_t);
   NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bQoldsMatrices, matrixSize,
                                                 VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
                                                 VMA_MEMORY_USAGE_GPU_ONLY));
@@ -695,18 +714,238 @@ void GltfRenderer::createQoldsBuffers()
                                                 VMA_MEMORY_USAGE_GPU_ONLY));
   NVVK_DBG_NAME(m_resources.bQoldsSeeds.buffer);
 
+  // Create scramble tree buffer (first levels of the Owen permutation tree of every dimension)
+  VkDeviceSize treeSize = tree.size() * sizeof(uint32_t);
+  NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bQoldsScrambleTree, treeSize,
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_resources.bQoldsScrambleTree.buffer);
+
+  // Create point table buffer, sized for the largest (float32) format so switching format only re-uploads
+  VkDeviceSize tableSize = VkDeviceSize(m_qoldsBuilder->getDimensions()) * m_qoldsBuilder->getMaxPoints() * sizeof(uint32_t);
+  NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bQoldsTable, tableSize,
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_resources.bQoldsTable.buffer);
+
   // Upload data using staging buffer
   VkCommandBuffer cmd{};
   nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
 
   m_resources.staging.appendBuffer(m_resources.bQoldsMatrices, 0, matrixSize, matrices.data());
   m_resources.staging.appendBuffer(m_resources.bQoldsSeeds, 0, seedsSize, seeds.data());
+  m_resources.staging.appendBuffer(m_resources.bQoldsScrambleTree, 0, treeSize, tree.data());
+  updateQoldsTable(cmd);
+
+  nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
+
+  m_resources.qoldsDimensions = m_qoldsBuilder->getDimensions();
+  m_resources.qoldsDigits     = m_qoldsBuilder->getDigits();
+
+  LOGI("QOLDS buffers created: %d dimensions, %d max points (budget %llu spp%s)\n", m_qoldsBuilder->getDimensions(),
+       m_qoldsBuilder->getMaxPoints(), static_cast<unsigned long long>(sampleBudget),
+       sampleBudget > uint64_t(m_qoldsBuilder->getMaxPoints()) ? ", padded with scrambled epochs" : "");
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create and upload the Sobol' direction numbers
+// They do not depend on the sample budget or the path depth: the dimension groups are padded in the shader
+void GltfRenderer::createSobolBuffers()
+{
+  if(!m_sobolBuilder)
+    m_sobolBuilder = std::make_unique<SobolBuilder>();
+
+  m_sobolBuilder->buildMatrices();
+  m_sobolBuilder->generateScrambleSeed(0);
+
+  const auto& directions = m_sobolBuilder->getMatrixData();
+
+  // Release the buffer of a previously loaded scene
+  m_resources.allocator.destroyBuffer(m_resources.bSobolMatrices);
+
+  VkDeviceSize directionsSize = directions.size() * sizeof(uint32_t);
+  NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bSobolMatrices, directionsSize,
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_resources.bSobolMatrices.buffer);
+
+  VkCommandBuffer cmd{};
+  nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
+  m_resources.staging.appendBuffer(m_resources.bSobolMatrices, 0, directionsSize, directions.data());
   m_resources.staging.cmdUploadAppended(cmd);
+  nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
+
+  m_resources.sobolSeed = m_sobolBuilder->getScrambleSeed();
+
+  LOGI("Sobol' buffers created: %d dimensions per group\n", m_sobolBuilder->getDimensions());
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the light selection buffers of the scene: the alias table over the power of the lights,
+// the light BVH and the emissive triangles. The scene keeps its lights: later changes of their
+// transform, color, intensity or cone only update the buffers.
+void GltfRenderer::createLightSamplingBuffers()
+{
+  m_lightAliasBuilder.build(m_resources.scene);
+  m_lightTreeBuilder.build(m_resources.scene);
+  const auto& table = m_lightAliasBuilder.getTable();
+  const auto& nodes = m_lightTreeBuilder.getNodes();
 
+  // Release the buffers of a previously loaded scene
+  m_resources.allocator.destroyBuffer(m_resources.bLightAlias);
+  m_resources.allocator.destroyBuffer(m_resources.bLightTree);
+
+  VkDeviceSize tableSize = table.size() * sizeof(shaderio::LightAliasEntry);
+  NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bLightAlias, tableSize,
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_resources.bLightAlias.buffer);
+
+  // A light turning directional changes the number of nodes: the buffer takes the most nodes of the scene
+  VkDeviceSize treeSize =
+      LightTreeBuilder::maxNodes(m_resources.scene.getRenderLights().size()) * sizeof(shaderio::LightTreeNode);
+  NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bLightTree, treeSize,
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_resources.bLightTree.buffer);
+
+  VkCommandBuffer cmd{};
+  nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
+  m_resources.staging.appendBuffer(m_resources.bLightAlias, 0, tableSize, table.data());
+  m_resources.staging.appendBuffer(m_resources.bLightTree, 0, nodes.size() * sizeof(shaderio::LightTreeNode), nodes.data());
+  m_emissiveCapacity = 0;  // New scene: new buffers
+  updateEmissiveTriangles();
+  m_resources.staging.cmdUploadAppended(cmd);
   nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
 
-  LOGI("QOLDS buffers created: %d dimensions, %d max points\n", m_qoldsBuilder->getDimensions(),
-       m_qoldsBuilder->getMaxPoints());
+  m_resources.lightPower        = m_lightAliasBuilder.getLightPower();
+  m_resources.lightTreeNodes    = m_lightTreeBuilder.getTreeNodes();
+  m_resources.lightTreeInfinite = m_lightTreeBuilder.getInfiniteLights();
+
+  LOGI("Light selection: %zu lights, total power %.3g, light BVH of %d nodes and %d directional lights\n",
+       m_resources.scene.getRenderLights().size(), m_resources.lightPower, m_resources.lightTreeNodes,
+       m_resources.lightTreeInfinite);
+  LOGI("Emissive triangles: %d, total power %.3g\n", m_resources.emissiveTriangles, m_resources.emissivePower);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Collect the emissive triangles of the scene and their alias table, at load and when materials change.
+// The buffers are reallocated when the scene gains emitters. Moving the nodes keeps the table: the
+// shader measures the triangles where they are, only the balance of the selection ages.
+// The staging buffer is uploaded by the caller.
+void GltfRenderer::updateEmissiveTriangles()
+{
+  m_emissiveBuilder.build(m_resources.scene);
+  const auto& triangles = m_emissiveBuilder.getTriangles();
+  const auto& offsets   = m_emissiveBuilder.getNodeOffsets();
+
+  if(triangles.size() > m_emissiveCapacity)
+  {
+    if(m_emissiveCapacity > 0)
+      vkDeviceWaitIdle(m_device);  // The buffers may be in use by a frame in flight
+    m_resources.allocator.destroyBuffer(m_resources.bEmissiveTriangles);
+    m_resources.allocator.destroyBuffer(m_resources.bEmissiveNodes);
+
+    NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bEmissiveTriangles, triangles.size() * sizeof(shaderio::EmissiveTriangle),
+                                                  VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                  VMA_MEMORY_USAGE_GPU_ONLY));
+    NVVK_DBG_NAME(m_resources.bEmissiveTriangles.buffer);
+    NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bEmissiveNodes, offsets.size() * sizeof(int),
+                                                  VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                  VMA_MEMORY_USAGE_GPU_ONLY));
+    NVVK_DBG_NAME(m_resources.bEmissiveNodes.buffer);
+    m_emissiveCapacity = triangles.size();
+  }
+
+  m_resources.staging.appendBuffer(m_resources.bEmissiveTriangles, 0, triangles.size() * sizeof(shaderio::EmissiveTriangle),
+                                   triangles.data());
+  m_resources.staging.appendBuffer(m_resources.bEmissiveNodes, 0, offsets.size() * sizeof(int), offsets.data());
+  m_resources.emissiveTriangles = m_emissiveBuilder.getTriangleCount();
+  m_resources.emissivePower     = m_emissiveBuilder.getEmissivePower();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Rebuild the alias table of the light selection and refit the light BVH, with the lights buffer of the scene
+// The staging buffer is uploaded by the caller, with the lights
+void GltfRenderer::updateLightSampling()
+{
+  m_lightAliasBuilder.build(m_resources.scene);
+  m_lightTreeBuilder.update(m_resources.scene);
+  const auto& table = m_lightAliasBuilder.getTable();
+  const auto& nodes = m_lightTreeBuilder.getNodes();
+
+  m_resources.staging.appendBuffer(m_resources.bLightAlias, 0, table.size() * sizeof(shaderio::LightAliasEntry), table.data());
+  m_resources.staging.appendBuffer(m_resources.bLightTree, 0, nodes.size() * sizeof(shaderio::LightTreeNode), nodes.data());
+  m_resources.lightPower        = m_lightAliasBuilder.getLightPower();
+  m_resources.lightTreeNodes    = m_lightTreeBuilder.getTreeNodes();
+  m_resources.lightTreeInfinite = m_lightTreeBuilder.getInfiniteLights();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Probability of sampleLights() sampling a light rather than the environment: the power of the lights
+// and emissive triangles (when next-event estimation samples them) against the power of the HDR
+// environment entering the scene. The physical sky has no integral, it keeps an even split. The path
+// tracer replaces this prior with the probability it learns from the contribution of both
+// (PathTracer::updateLightSelect).
+float GltfRenderer::getLightSelectProbability() const
+{
+  if(m_resources.lightSelectLearned >= 0.0f)
+    return m_resources.lightSelectLearned;
+  double environmentPower = -1.0;
+  if(m_resources.settings.envSystem == shaderio::EnvSystem::eHdr)
+  {
+    environmentPower = LightAliasBuilder::environmentPower(m_resources.hdrIbl.getIntegral(), m_resources.settings.hdrEnvIntensity,
+                                                           m_resources.scene.getSceneBounds().radius());
+  }
+  const double emissivePower = m_pathTracer.isEmissiveLightsEnabled() ? m_resources.emissivePower : 0.0;
+  return LightAliasBuilder::lightSelectProbability(m_resources.lightPower + emissivePower, environmentPower);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Probability of a light sample picking an emissive triangle rather than a punctual light: learned, or
+// from their power
+float GltfRenderer::getEmissiveSelectProbability() const
+{
+  if(m_resources.emissiveSelectLearned >= 0.0f)
+    return m_resources.emissiveSelectLearned;
+  return LightAliasBuilder::lightSelectProbability(m_resources.emissivePower, m_resources.lightPower);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Resize the QOLDS net when the sample budget needs a different number of digits, or the max depth
+// more dimensions than the built ones
+// Returns true if the sequence changed, which restarts the accumulation
+bool GltfRenderer::updateQoldsSequence()
+{
+  if(!m_qoldsBuilder)
+    return false;
+
+  const int digits     = QOLDSBuilder::digitsForSampleCount(m_pathTracer.getSampleBudget(m_resources));
+  const int dimensions = std::min(m_pathTracer.getSampleDimensions(), QOLDS_MAX_DIMENSIONS - 1);
+  if(digits == m_qoldsBuilder->getDigits() && dimensions <= m_qoldsBuilder->getDimensions())
+    return false;
+
+  vkDeviceWaitIdle(m_device);  // The buffers are recreated while previous frames may still read them
+  createQoldsBuffers();
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Build the QOLDS point table in the format selected by the path tracer and upload it
+// The table holds the scrambled points, so it must be rebuilt whenever seeds or format change
+void GltfRenderer::updateQoldsTable(VkCommandBuffer cmd)
+{
+  if(!m_qoldsBuilder || m_resources.bQoldsTable.buffer == VK_NULL_HANDLE)
+    return;
+
+  QOLDSBuilder::TableFormat format = (m_pathTracer.m_qoldsMode == shaderio::QoldsMode::eQoldsTableUnorm16) ?
+                                         QOLDSBuilder::TableFormat::eUnorm16 :
+                                         QOLDSBuilder::TableFormat::eFloat32;
+  m_qoldsBuilder->buildPointTable(format);
+
+  const auto& table = m_qoldsBuilder->getPointTableData();
+  m_resources.staging.appendBuffer(m_resources.bQoldsTable, 0, table.size() * sizeof(uint32_t), table.data());
+  m_resources.staging.cmdUploadAppended(cmd);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -807,6 +1046,26 @@ void GltfRenderer::createDescriptorSets()
                                               1, VK_SHADER_STAGE_ALL);
   m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eQoldsSeeds, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
                                               VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eQoldsTable, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                              VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eQoldsScrambleTree, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                              1, VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eSobolMatrices, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                              VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eWavefrontCounters, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                              1, VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eAdaptiveErrorSums, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                              1, VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::ePathtraceCounters, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                              1, VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eLightAlias, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                              VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eLightTree, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                              VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eEmissiveTriangles, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                              1, VK_SHADER_STAGE_ALL);
+  m_resources.descriptorBinding[1].addBinding(shaderio::BindingPoints::eEmissiveNodes, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                                              VK_SHADER_STAGE_ALL);
 
   NVVK_CHECK(m_resources.descriptorBinding[1].createDescriptorSetLayout(m_device, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
                                                                         &m_resources.descriptorSetLayout[1]));
@@ -871,7 +1130,8 @@ void GltfRenderer::updateHdrImages()
 // Reset the frame counter
 void GltfRenderer::resetFrame()
 {
-  m_resources.frameCount = -1;
+  m_resources.frameCount   = -1;
+  m_resources.framePending = false;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -895,6 +1155,12 @@ bool GltfRenderer::updateFrameCounter()
     ref_fov        = fov;
   }
 
+  // The path tracer renders the rest of the frame
+  if(m_resources.framePending)
+  {
+    return true;
+  }
+
   if(m_resources.frameCount >= m_resources.settings.maxFrames)
   {
     return false;
@@ -966,6 +1232,13 @@ void GltfRenderer::destroyResources()
   m_resources.allocator.destroyBuffer(m_resources.bSkyParams);
   m_resources.allocator.destroyBuffer(m_resources.bQoldsMatrices);
   m_resources.allocator.destroyBuffer(m_resources.bQoldsSeeds);
+  m_resources.allocator.destroyBuffer(m_resources.bQoldsTable);
+  m_resources.allocator.destroyBuffer(m_resources.bQoldsScrambleTree);
+  m_resources.allocator.destroyBuffer(m_resources.bSobolMatrices);
+  m_resources.allocator.destroyBuffer(m_resources.bLightAlias);
+  m_resources.allocator.destroyBuffer(m_resources.bLightTree);
+  m_resources.allocator.destroyBuffer(m_resources.bEmissiveTriangles);
+  m_resources.allocator.destroyBuffer(m_resources.bEmissiveNodes);
 
   vkDestroyDescriptorSetLayout(m_device, m_resources.descriptorSetLayout[0], nullptr);
   vkDestroyDescriptorSetLayout(m_device, m_resources.descriptorSetLayout[1], nullptr);
@@ -1031,10 +1304,12 @@ bool GltfRenderer::updateSceneChanges(VkCommandBuffer cmd, bool didAnimate)
   if(m_uiSceneGraph.hasMaterialChanged())
   {
     m_resources.sceneVk.updateMaterialBuffer(cmd, m_resources.staging, m_resources.scene);
+    updateEmissiveTriangles();
   }
   if(m_uiSceneGraph.hasLightChanged())
   {
     m_resources.sceneVk.updateRenderLightsBuffer(cmd, m_resources.staging, m_resources.scene);
+    updateLightSampling();
   }
   if(m_resources.dirtyFlags.test(DirtyFlags::eVulkanScene))
   {
@@ -1042,6 +1317,7 @@ bool GltfRenderer::updateSceneChanges(VkCommandBuffer cmd, bool didAnimate)
     m_resources.sceneVk.updateRenderNodesBuffer(cmd, m_resources.staging, m_resources.scene);
     m_resources.sceneVk.updateRenderPrimitivesBuffer(cmd, m_resources.staging, m_resources.scene);
     m_resources.sceneVk.updateRenderLightsBuffer(cmd, m_resources.staging, m_resources.scene);
+    updateLightSampling();
     m_resources.dirtyFlags.reset(DirtyFlags::eVulkanScene);
     changed = true;
   }
@@ -1051,6 +1327,7 @@ bool GltfRenderer::updateSceneChanges(VkCommandBuffer cmd, bool didAnimate)
     m_resources.sceneVk.updateRenderNodesBuffer(cmd, m_resources.staging, m_resources.scene);
     m_resources.sceneVk.updateRenderPrimitivesBuffer(cmd, m_resources.staging, m_resources.scene);
     m_resources.sceneVk.updateRenderLightsBuffer(cmd, m_resources.staging, m_resources.scene);
+    updateLightSampling();
     // Make sure the staging buffers are uploaded before the acceleration structures are updated
     m_resources.staging.cmdUploadAppended(cmd);
     // Ensure all buffer copy operations complete before acceleration structure build begins
@@ -1059,6 +1336,17 @@ bool GltfRenderer::updateSceneChanges(VkCommandBuffer cmd, bool didAnimate)
     m_resources.sceneRtx.updateBottomLevelAS(cmd, m_resources.scene);
     m_resources.sceneRtx.updateTopLevelAS(cmd, m_resources.staging, m_resources.scene);
   }
+  if(m_resources.dirtyFlags.test(DirtyFlags::eQoldsSequence))
+  {
+    changed |= updateQoldsSequence();  // Also rebuilds the point table
+    m_resources.dirtyFlags.reset(DirtyFlags::eQoldsSequence);
+  }
+  if(m_resources.dirtyFlags.test(DirtyFlags::eQoldsTable))
+  {
+    updateQoldsTable(cmd);
+    m_resources.dirtyFlags.reset(DirtyFlags::eQoldsTable);
+    changed = true;
+  }
   if(m_uiSceneGraph.hasMaterialFlagChanges() || m_uiSceneGraph.hasVisibilityChanged())
   {
     m_resources.scene.updateRenderNodes();
@@ -54,6 +54,10 @@
 #include "ui_busy_window.hpp"
 #include "ui_scene_graph.hpp"
 #include "qolds_builder.hpp"
+#include "sobol_builder.hpp"
+#include "light_alias_builder.hpp"
+#include "light_tree_builder.hpp"
+#include "emissive_builder.hpp"
 
 class GltfRenderer : public nvapp::IAppElement
 {
@@ -88,6 +92,14 @@ private:
   void createResourceBuffers();
   void createVulkanScene();
   void createQoldsBuffers();
+  void createSobolBuffers();
+  void createLightSamplingBuffers();
+  void updateLightSampling();
+  void updateEmissiveTriangles();
+  float getLightSelectProbability() const;
+  float getEmissiveSelectProbability() const;
+  void updateQoldsTable(VkCommandBuffer cmd);
+  bool updateQoldsSequence();
   void destroyResources();
   void resetFrame();
   void silhouette(VkCommandBuffer cmd);
@@ -142,6 +154,13 @@ private:
 
   // QOLDS sampling
   std::unique_ptr<QOLDSBuilder> m_qoldsBuilder;  // QOLDS matrix generator
+  std::unique_ptr<SobolBuilder> m_sobolBuilder;  // Sobol' direction numbers
+
+  // Light selection
+  LightAliasBuilder m_lightAliasBuilder;    // Power of the lights and alias table of sampleLights()
+  LightTreeBuilder  m_lightTreeBuilder;     // Light BVH of sampleLights()
+  EmissiveBuilder   m_emissiveBuilder;      // Emissive triangles of sampleLights()
+  size_t            m_emissiveCapacity{0};  // Emissive triangles the buffers hold
 
   std::unordered_map<int, int> m_nodeToRenderNodeMap;  // Maps node IDs to render node indices
 
@@ -28,7 +28,12 @@
 #include <nvutils/parameter_registry.hpp>
 #include <nvgui/tooltip.hpp>
 
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
 #include "renderer_pathtracer.hpp"
+#include "light_alias_builder.hpp"
 #include "utils.hpp"
 
 // Pre-compiled shaders
@@ -72,7 +77,37 @@ void PathTracer::onAttach(Resources& resources, nvvk::ProfilerGpuTimer* profiler
   m_useSER = m_supportSER;
 
   // Log initial sampling mode
-  LOGI("Path tracer initialized with %s sampling\n", m_useQOLDS ? "QOLDS" : "PCG (default)");
+  LOGI("Path tracer initialized with %s sampling\n", getSamplerName(m_samplerType));
+
+  // State of every frame (adaptive sampling, time slicing), read by every pixel
+  NVVK_CHECK(resources.allocator.createBuffer(m_frameState, sizeof(shaderio::PathtraceFrameState),
+                                              VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                              VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_frameState.buffer);
+  NVVK_CHECK(resources.allocator.createBuffer(m_adaptiveErrorSums, ADAPTIVE_ERROR_SUMS * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                              VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_adaptiveErrorSums.buffer);
+  NVVK_CHECK(resources.allocator.createBuffer(m_pathtraceCounters, PATHTRACE_COUNTERS * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT
+                                                  | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                              VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_pathtraceCounters.buffer);
+  NVVK_CHECK(resources.allocator.createBuffer(m_laneStatsReadback, LANE_STATS_LATENCY * PATHTRACE_COUNTERS * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                              VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+  NVVK_DBG_NAME(m_laneStatsReadback.buffer);
+  m_pushConst.frameState = (shaderio::PathtraceFrameState*)m_frameState.address;
+
+  // Timestamps of the calls, for the cost model
+  const VkQueryPoolCreateInfo queryPoolInfo{
+      .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = 2 * LANE_STATS_LATENCY,
+  };
+  NVVK_CHECK(vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_timestampPool));
+  NVVK_DBG_NAME(m_timestampPool);
+  m_timestampPeriodNs = double(prop2.properties.limits.timestampPeriod);
 
   // #DLSS - Create the DLSS denoiser
 #if defined(USE_DLSS)
@@ -91,8 +126,27 @@ void PathTracer::registerParameters(nvutils::ParameterRegistry* paramReg)
   paramReg->add({"ptAperture", "PathTracer: Camera aperture"}, &m_pushConst.aperture);
   paramReg->add({"ptFocalDistance", "PathTracer: Focal distance"}, &m_pushConst.focalDistance);
   paramReg->add({"ptAutoFocus", "PathTracer: Enable auto focus"}, &m_autoFocus);
-  paramReg->add({"ptTechnique", "PathTracer: Rendering technique [RayQuery:0, RayTracing:1]"}, (int*)&m_renderTechnique);
+  paramReg->add({"ptTechnique", "PathTracer: Rendering technique [RayQuery:0, RayTracing:1, Wavefront:2, Persistent:3]"}, (int*)&m_renderTechnique);
+  paramReg->add({"ptPersistentGroups", "PathTracer: Workgroups of the persistent-threads grid"}, &m_persistentGroups);
+  paramReg->add({"ptLightTree", "PathTracer: Sample the lights with a light BVH instead of by power alone"}, &m_lightTree);
+  paramReg->add({"ptEmissiveLights", "PathTracer: Sample the emissive triangles as area lights"}, &m_emissiveLights);
+  paramReg->add({"ptAdaptiveLightSelect", "PathTracer: Learn the light selection probabilities from the first frames"}, &m_adaptiveLightSelect);
+  paramReg->add({"ptRestir", "PathTracer: ReSTIR DI, spatiotemporal resampling of the direct light of the primary hits"}, &m_restir);
+  paramReg->add({"ptRestirCandidates", "PathTracer: ReSTIR DI light samples per pixel and frame"}, &m_restirCandidates);
+  paramReg->add({"ptRestirTemporal", "PathTracer: ReSTIR DI reuse of the previous frame"}, &m_restirTemporal);
+  paramReg->add({"ptRestirSpatialSamples", "PathTracer: ReSTIR DI neighbors reused"}, &m_restirSpatialSamples);
+  paramReg->add({"ptRestirSpatialRadius", "PathTracer: ReSTIR DI radius of the neighbors, in pixels"}, &m_restirSpatialRadius);
+  paramReg->add({"ptGuiding", "PathTracer: Path guiding, the BSDF samples mixed with an SD-tree learned from the paths"}, &m_guiding);
+  paramReg->add({"ptSampleSplit", "PathTracer: Share the samples of a pixel between threads on small images"}, &m_sampleSplit);
+  paramReg->add({"ptLaneStats", "PathTracer: Measure the SIMD lane occupancy of the path tracing loop"}, &m_laneStats);
   paramReg->add({"ptAdaptiveSampling", "PathTracer: Enable adaptive sampling"}, &m_adaptiveSampling);
+  paramReg->add({"ptAdaptivePixels", "PathTracer: Per-pixel adaptive sampling, driven by the variance of every pixel"}, &m_adaptivePixels);
+  paramReg->add({"ptNoiseThreshold", "PathTracer: Relative error under which a pixel stops being traced"}, &m_noiseThreshold);
+  paramReg->add({"ptTimeSlicing", "PathTracer: Split the frame in row slices that fit the frame budget"}, &m_timeSlicing);
+  paramReg->add({"ptSliceBudget", "PathTracer: GPU milliseconds of a slice when Auto SPP is off"}, &m_sliceBudgetMs);
+  paramReg->add({"ptSampler", "PathTracer: Sampler [PCG:0, QOLDS:1, SobolOwen:2]"}, (int*)&m_samplerType);
+  paramReg->add({"ptQoldsMode", "PathTracer: QOLDS evaluation [Analytic:0, TableFloat:1, TableUnorm16:2]"}, (int*)&m_qoldsMode);
+  paramReg->add({"ptQoldsPerPixel", "PathTracer: Decorrelate the QOLDS or Sobol' sequence per pixel"}, &m_qoldsPerPixel);
   paramReg->add({"ptPerformanceTarget", "PathTracer: Performance target [Interactive:0, Balanced:1, Quality:2, MaxQuality:3]"},
                 (int*)&m_performanceTarget);
 #if defined(USE_DLSS)
@@ -112,8 +166,19 @@ void PathTracer::onDetach(Resources& resources)
   vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
   //vkDestroyShaderEXT(m_device, m_shader, nullptr);
   vkDestroyShaderModule(m_device, m_shaderModule, nullptr);
-  vkDestroyPipeline(m_device, m_rtxPipeline, nullptr);
-  vkDestroyPipeline(m_device, m_rqPipeline, nullptr);
+  destroyPipelines();
+  destroyWavefrontBuffers(resources);
+  resources.allocator.destroyBuffer(m_frameState);
+  resources.allocator.destroyBuffer(m_adaptiveErrorSums);
+  resources.allocator.destroyBuffer(m_adaptiveStats);
+  resources.allocator.destroyBuffer(m_pathtraceCounters);
+  resources.allocator.destroyBuffer(m_laneStatsReadback);
+  vkDestroyQueryPool(m_device, m_timestampPool, nullptr);
+  m_timestampPool = VK_NULL_HANDLE;
+  resources.allocator.destroyBuffer(m_splitPartials);
+  resources.allocator.destroyBuffer(m_restirBuffer);
+  resources.allocator.destroyBuffer(m_guidingRecords);
+  resources.allocator.destroyBuffer(m_guidingTree);
   m_pipelineCache.deinit();
 }
 
@@ -149,16 +214,34 @@ bool PathTracer::onUIRender(Resources& resources)
   if(PE::begin())
   {
     // Rendering technique selector
-    const char* techniques[] = {"Ray Query", "Ray Tracing"};
+    const char* techniques[] = {"Ray Query", "Ray Tracing", "Wavefront", "Ray Query (Persistent)"};
     int         current      = static_cast<int>(m_renderTechnique);
     if(PE::Combo("Rendering Technique", &current, techniques, IM_ARRAYSIZE(techniques)))
     {
+      // The wavefront queues hold the state of every pixel: release them when leaving the technique
+      if(m_renderTechnique == RenderTechnique::Wavefront)
+      {
+        vkDeviceWaitIdle(m_device);
+        destroyWavefrontBuffers(resources);
+      }
       m_renderTechnique = static_cast<RenderTechnique>(current);
       changed           = true;
+      m_laneOccupancyRollingAvg = {};
+      m_laneStatsFrame          = 0;
     }
     nvgui::tooltip(
-        "Both Ray Query and Ray Tracing use hardware accelerated ray tracing."
-        "Ray Query uses a compute shader interface, while Ray Tracing uses the dedicated RTX pipeline.");
+        "All techniques use hardware accelerated ray tracing. "
+        "Ray Query uses a compute shader interface, while Ray Tracing uses the dedicated RTX pipeline. "
+        "Wavefront splits each bounce into generate, extend, shade and shadow kernels that exchange rays "
+        "and hits through queues, and shades the hits sorted by material. "
+        "Ray Query (Persistent) runs a fixed grid of workgroups whose threads pull pixels from a global counter, "
+        "taking the next pixel as soon as they are done with one.");
+
+    if(m_renderTechnique == RenderTechnique::Persistent)
+    {
+      PE::SliderInt("Persistent Groups", &m_persistentGroups, 16, 8192, "%d", ImGuiSliderFlags_Logarithmic,
+                    "Workgroups of the persistent grid: enough to fill every multiprocessor of the GPU");
+    }
 
     if(m_supportSER && m_renderTechnique == RenderTechnique::RayTracing)
     {
@@ -174,7 +257,11 @@ bool PathTracer::onUIRender(Resources& resources)
       }
     }
 
-    changed |= PE::SliderInt("Max Depth", &m_pushConst.maxDepth, 0, 20, "%d", 0, "Maximum number of bounces");
+    if(PE::SliderInt("Max Depth", &m_pushConst.maxDepth, 0, 20, "%d", 0, "Maximum number of bounces"))
+    {
+      resources.dirtyFlags.set(DirtyFlags::eQoldsSequence);  // Deeper paths may need more QOLDS dimensions
+      changed = true;
+    }
     changed |= PE::SliderFloat("FireFly Clamp", &m_pushConst.fireflyClampThreshold, 0.0f, 10.0f, "%.2f", 0,
                                "Clamp threshold for fireflies");
     PE::end();
@@ -183,16 +270,54 @@ bool PathTracer::onUIRender(Resources& resources)
   // Sampling method selection
   if(PE::begin())
   {
-    bool prevQOLDS = m_useQOLDS;
-    changed |= PE::Checkbox("Use QOLDS", &m_useQOLDS, "Use Quad-Optimized Low-Discrepancy Sequences for Monte Carlo sampling");
+    const char* samplers[] = {"PCG", "QOLDS", "Sobol' (Owen)"};
+    int         sampler    = static_cast<int>(m_samplerType);
+    if(PE::Combo("Sampler", &sampler, samplers, IM_ARRAYSIZE(samplers)))
+    {
+      m_samplerType = static_cast<shaderio::SamplerType>(sampler);
+      LOGI("Switched to %s sampling\n", getSamplerName(m_samplerType));
+
+      // The sampler is a specialization constant: recreate the pipelines
+      vkDeviceWaitIdle(m_device);
+      destroyPipelines();
+      changed = true;
+    }
+    nvgui::tooltip(
+        "PCG: independent pseudo-random numbers. "
+        "QOLDS: Quad-Optimized Low-Discrepancy Sequences, base-3 nets with Owen scrambling. "
+        "Sobol' (Owen): base-2 Sobol' points with hash-based Owen scrambling and padded dimension groups.");
 
-    // Log when QOLDS toggle changes
-    if(m_useQOLDS != prevQOLDS)
+    if(m_samplerType == shaderio::SamplerType::eSamplerSobolOwen)
     {
-      if(m_useQOLDS)
-        LOGI("Switched to QOLDS sampling (Quad-Optimized Low-Discrepancy Sequences)\n");
-      else
-        LOGI("Switched to PCG sampling (default pseudo-random)\n");
+      changed |= PE::Checkbox("Per-Pixel Decorrelation", &m_qoldsPerPixel,
+                              "Give every pixel its own Owen scrambling of the sequence, instead of the same point in all pixels");
+    }
+
+    if(m_samplerType == shaderio::SamplerType::eSamplerQolds)
+    {
+      const char* modes[] = {"Analytic", "Table (float32)", "Table (unorm16)"};
+      int         current = static_cast<int>(m_qoldsMode);
+      if(PE::Combo("QOLDS Evaluation", &current, modes, IM_ARRAYSIZE(modes)))
+      {
+        m_qoldsMode = static_cast<shaderio::QoldsMode>(current);
+        if(m_qoldsMode == shaderio::QoldsMode::eQoldsTableFloat || m_qoldsMode == shaderio::QoldsMode::eQoldsTableUnorm16)
+          resources.dirtyFlags.set(DirtyFlags::eQoldsTable);  // Table is rebuilt in the selected format
+        changed = true;
+      }
+      nvgui::tooltip(
+          "Analytic evaluates the generator matrices and the Owen scrambling for every sample. "
+          "Table reads the point from the precomputed scrambled point table.");
+      changed |= PE::Checkbox("Per-Pixel Decorrelation", &m_qoldsPerPixel,
+                              "Give every pixel its own Owen scrambling (analytic) or rotation (table) of the sequence, "
+                              "instead of the same point in all pixels");
+      if(resources.qoldsDigits > 0)
+      {
+        ImGui::TextDisabled("Net: 3^%d points, budget %llu spp", resources.qoldsDigits,
+                            static_cast<unsigned long long>(getSampleBudget(resources)));
+        nvgui::tooltip(
+            "The net is sized for Max Iterations x samples per frame. Samples past it continue "
+            "with independently scrambled copies of the net.");
+      }
     }
 
     PE::end();
@@ -214,7 +339,76 @@ bool PathTracer::onUIRender(Resources& resources)
       PE::end();
   }
 
+  // Light selection
+  if(PE::begin())
+  {
+    changed |= PE::Checkbox("Light Tree", &m_lightTree,
+                            "Pick the lights with a light BVH, by their distance, power and orientation from the shading point, "
+                            "instead of by power alone");
+    if(m_lightTree)
+    {
+      ImGui::SameLine();
+      ImGui::TextDisabled("(%d nodes, %d directional)", resources.lightTreeNodes, resources.lightTreeInfinite);
+    }
+    changed |= PE::Checkbox("Emissive Lights", &m_emissiveLights,
+                            "Sample the emissive triangles as area lights, weighted against the BSDF rays hitting them, "
+                            "instead of only finding them with BSDF rays");
+    if(m_emissiveLights)
+    {
+      ImGui::SameLine();
+      ImGui::TextDisabled("(%d triangles)", resources.emissiveTriangles);
+    }
+    changed |= PE::Checkbox("Adaptive Selection", &m_adaptiveLightSelect,
+                            "Choose between the environment, the lights and the emissive triangles by their contribution "
+                            "to the first frames of the render, occlusion included, instead of by their power");
+    if(m_adaptiveLightSelect && resources.lightSelectLearned >= 0.0f)
+    {
+      ImGui::SameLine();
+      ImGui::TextDisabled("(lights %.2f, emissive %.2f)", resources.lightSelectLearned, resources.emissiveSelectLearned);
+    }
+    PE::end();
+  }
+
+  // ReSTIR DI
+  if(PE::begin())
+  {
+    ImGui::BeginDisabled(m_renderTechnique == RenderTechnique::Wavefront);
+    changed |= PE::Checkbox("ReSTIR DI", &m_restir,
+                            "Light the primary hits with a light sample resampled from many candidates: the ones of the "
+                            "pixel, of the previous frame and of the neighbors. Biased, but clean at one sample per pixel. "
+                            "Not with Wavefront.");
+    if(m_restir)
+    {
+      changed |= PE::SliderInt("Candidates", &m_restirCandidates, 1, 64, "%d", ImGuiSliderFlags_Logarithmic,
+                               "Light samples streamed into the reservoir of every pixel in a frame");
+      changed |= PE::Checkbox("Temporal Reuse", &m_restirTemporal, "Reuse the reservoir of the previous frame where the surface was");
+      changed |= PE::SliderInt("Spatial Samples", &m_restirSpatialSamples, 0, 16, "%d", 0,
+                               "Neighbors whose reservoirs are reused, among the ones with a similar surface");
+      changed |= PE::SliderFloat("Spatial Radius", &m_restirSpatialRadius, 1.0f, 64.0f, "%.0f", 0,
+                                 "Pixels around the pixel where the neighbors are picked");
+    }
+    ImGui::EndDisabled();
+    PE::end();
+  }
+
+  // Path guiding
+  if(PE::begin())
+  {
+    ImGui::BeginDisabled(m_renderTechnique == RenderTechnique::Wavefront);
+    changed |= PE::Checkbox("Path Guiding", &m_guiding,
+                            "Sample the bounces from the BSDF or from the incident radiance learned in every region of "
+                            "the scene (SD-tree), refined after 1, 2, 4, 8... frames. Not with Wavefront.");
+    ImGui::EndDisabled();
+    if(isGuidingEnabled() && m_guidingActive)
+    {
+      ImGui::TextDisabled("Iteration %d: %d regions, %zu directional nodes", m_guidingIteration,
+                          m_guidingBuilder.getRegionCount(), m_guidingBuilder.getDirectionalNodes().size());
+    }
+    PE::end();
+  }
+
   // Manual sampling controls
+  const uint64_t prevSampleBudget = getSampleBudget(resources);
   if(PE::begin())
   {
     PE::SliderInt("Max Iterations", &resources.settings.maxFrames, 0, 10000, "%d", 0, "Maximum number of iterations");
@@ -241,6 +435,12 @@ bool PathTracer::onUIRender(Resources& resources)
     {
       ImGui::SameLine();
       ImGui::TextDisabled("(Auto: %d spp)", m_pushConst.numSamples);
+      auto cost = m_sampleCostMs.find(getSampleCostKey(resources));
+      if(cost != m_sampleCostMs.end() && cost->second > 0.0)
+      {
+        ImGui::TextDisabled("Cost: %.3f ms / spp / MPixel", cost->second);
+        nvgui::tooltip("GPU time of one sample per pixel over a megapixel, measured on this scene and technique");
+      }
 
       // Performance target selection
       const char* targets[] = {"Interactive (60 FPS)", "Balanced (30 FPS)", "Quality (15 FPS)", "Max Quality (10 FPS)"};
@@ -250,6 +450,43 @@ bool PathTracer::onUIRender(Resources& resources)
         m_performanceTarget = static_cast<PerformanceTarget>(currentTarget);
       }
     }
+    // Per-pixel adaptive sampling
+    ImGui::BeginDisabled(isDlssEnabled());
+    changed |= PE::Checkbox("Adaptive Pixels", &m_adaptivePixels,
+                            "Track the variance of every pixel: tiles take samples in proportion to their error, "
+                            "and pixels under the noise threshold are no longer traced");
+    ImGui::EndDisabled();
+    if(m_adaptivePixels)
+    {
+      // Changing the threshold lets converged pixels resume (or stop sooner), the render goes on
+      PE::SliderFloat("Noise Threshold", &m_noiseThreshold, 0.001f, 0.2f, "%.3f", ImGuiSliderFlags_Logarithmic,
+                      "Relative error of the pixel mean under which the pixel stops");
+      PE::SliderInt("Min Samples", &m_adaptiveMinSamples, 2, 256, "%d", 0, "Samples a pixel takes before it may stop");
+    }
+
+    // Time slicing: a frame too long for the budget is rendered in bands of rows over several calls
+    ImGui::BeginDisabled(isDlssEnabled() || m_renderTechnique == RenderTechnique::Wavefront);
+    PE::Checkbox("Time Slicing", &m_timeSlicing,
+                 "Render the frame in bands of rows, each within the frame budget, so a costly frame does not stall the UI");
+    ImGui::EndDisabled();
+    if(m_timeSlicing && !m_adaptiveSampling)
+    {
+      PE::SliderFloat("Slice Budget (ms)", &m_sliceBudgetMs, 4.0f, 100.0f, "%.1f", 0, "GPU time of a slice");
+    }
+
+    // Sample split: the samples of a pixel spread over threads when the image is too small to fill the GPU
+    ImGui::BeginDisabled(m_renderTechnique != RenderTechnique::RayQuery && m_renderTechnique != RenderTechnique::RayTracing);
+    PE::Checkbox("Sample Split", &m_sampleSplit,
+                 "On small images, share the samples of a pixel between several threads, "
+                 "whose sums are then added up, so that the GPU is filled");
+    ImGui::EndDisabled();
+    const uint32_t sampleSplit = getSampleSplit(resources.gBuffers.getSize());
+    if(sampleSplit > 1)
+    {
+      ImGui::SameLine();
+      ImGui::TextDisabled("(%u threads / pixel)", sampleSplit);
+    }
+
     // Performance info - always visible
     ImGui::TextDisabled("Samples: %d/%d (%.1fx)", m_totalSamplesAccumulated, resources.frameCount + 1,
                         m_totalSamplesAccumulated / float(resources.frameCount + 1));
@@ -257,8 +494,27 @@ bool PathTracer::onUIRender(Resources& resources)
     ImGui::TextDisabled("Throughput: %.2f MSPP/s", m_throughputRollingAvg.getAverage());
     nvgui::tooltip("Mega-sample-pixels per second (rolling average over last %zu frames)", m_throughputRollingAvg.SAMPLE_COUNT);
 
+    // The lane statistics are a specialization constant: recreate the pipelines
+    if(PE::Checkbox("Lane Statistics", &m_laneStats, "Count the active SIMD lanes at every bounce of the path tracing loop (Ray Query techniques)"))
+    {
+      vkDeviceWaitIdle(m_device);
+      destroyPipelines();
+      m_laneOccupancyRollingAvg = {};
+      m_laneStatsFrame          = 0;
+    }
+    if(m_laneStats)
+    {
+      ImGui::TextDisabled("Lane Occupancy: %.1f%%", m_laneOccupancyRollingAvg.getAverage());
+      nvgui::tooltip("Active lanes over the lanes of the waves, at every bounce (rolling average over last %zu frames)",
+                     m_laneOccupancyRollingAvg.SAMPLE_COUNT);
+    }
+
     PE::end();
   }
+  if(getSampleBudget(resources) != prevSampleBudget)
+  {
+    resources.dirtyFlags.set(DirtyFlags::eQoldsSequence);  // The net may need more (or fewer) digits
+  }
 
   // Camera controls
   if(PE::begin())
@@ -314,14 +570,31 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
 
   m_sceneRadius = resources.scene.getSceneBounds().radius();
 
+  // Time slicing: a frame may take several calls, each rendering the next rows of the image.
+  // The sample count and the counters only change when a new frame starts.
+  const bool frameStart = !resources.framePending;
+
   // Handle frame reset detection (needed for both adaptive and non-adaptive modes)
-  if(resources.frameCount == 0)
+  if(resources.frameCount == 0 && frameStart)
   {
     m_totalSamplesAccumulated = 0;  // Reset sample counter when scene/camera changes
   }
 
   // Handle adaptive sampling
-  updateAdaptiveSampling(resources);
+  measureSampleCost(resources);
+  readLaneStats();
+
+  // The cost model times the whole call
+  const uint32_t timestampSlot = m_callIndex % LANE_STATS_LATENCY;
+  vkCmdResetQueryPool(cmd, m_timestampPool, 2 * timestampSlot, 2);
+  vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_timestampPool, 2 * timestampSlot);
+
+  if(frameStart)
+  {
+    updateAdaptiveSampling(resources);
+    updateLightSelect(resources);
+    updateGuiding(cmd, resources);
+  }
 
 
   // Update the push constant: the camera information, sky parameters and the scene to render
@@ -349,6 +622,11 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
   }
   m_pushConst.jitter = shaderio::dlssJitter(frameCount);
 #endif
+
+  // All slices of a frame take the same number of samples
+  if(frameStart)
+    m_frameNumSamples = m_pushConst.numSamples;
+  m_pushConst.numSamples = m_frameNumSamples;
   static int lastRenderedObject = -1;
   m_pushConst.renderSelection   = resources.selectedObject != lastRenderedObject || resources.frameCount == 0;
   lastRenderedObject            = resources.selectedObject;
@@ -358,13 +636,14 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
   m_pushConst.skyParams         = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
   m_pushConst.gltfScene         = (shaderio::GltfScene*)resources.sceneVk.sceneDesc().address;
   m_pushConst.mouseCoord        = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
-  m_pushConst.useQOLDS          = m_useQOLDS ? 1 : 0;  // QOLDS sampling toggle 
+  m_pushConst.sobolSeed         = resources.sobolSeed;
+  m_pushConst.qoldsMode         = m_qoldsMode;
+  m_pushConst.qoldsPerPixel     = m_qoldsPerPixel ? 1 : 0;
+  m_pushConst.qoldsDimensions   = resources.qoldsDimensions;
+  m_pushConst.qoldsDigits       = resources.qoldsDigits;
   m_pushConst.useFastMSX        = m_useFastMSX ? 1 : 0;
   vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(shaderio::PathtracePushConstant), &m_pushConst);
 
-  // Track total samples accumulated
-  m_totalSamplesAccumulated += m_pushConst.numSamples;
-
   // Make sure buffer is ready to be used
   nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
 
@@ -376,6 +655,36 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
     renderingSize = m_dlss->getRenderSize();
   }
 #endif
+  const VkExtent2D imageSize = renderingSize;
+
+  // Time slicing: the rows of this call, from the cursor. The frame is complete at the last row.
+  if(frameStart)
+    m_sliceCursor = 0;
+  const uint32_t sliceOffset = m_sliceCursor;
+  renderingSize.height       = std::min(getSliceRows(resources, imageSize), imageSize.height - sliceOffset);
+  m_sliceCursor += renderingSize.height;
+  const bool frameComplete = m_sliceCursor >= imageSize.height;
+  resources.framePending   = !frameComplete;
+
+  // Track total samples accumulated
+  if(frameComplete)
+    m_totalSamplesAccumulated += m_pushConst.numSamples;
+
+  // Adaptive sampling and time slicing state of this call
+  // Sample split: small images share the samples of a pixel between threads
+  const uint32_t sampleSplit = getSampleSplit(imageSize);
+
+  // ReSTIR DI: new reservoirs every frame, the previous ones lost when it was off or the render size changed
+  if(frameStart)
+  {
+    m_restirFrame++;
+    if(!isRestirEnabled() || imageSize.width != m_restirImageSize.width || imageSize.height != m_restirImageSize.height)
+      m_restirHistoryValid = false;
+    m_restirImageSize = imageSize;
+  }
+  updateFrameState(cmd, resources, VkRect2D{{0, int32_t(sliceOffset)}, renderingSize}, sampleSplit);
+  if(isRestirEnabled() && frameStart)
+    dispatchRestir(cmd, resources, imageSize);
 
 
   if(m_renderTechnique == RenderTechnique::RayQuery)
@@ -394,18 +703,32 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_rqPipeline);
 
 
-    // Bind the descriptor set: TLAS, output image, textures, etc. (Set: 0)
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &resources.descriptorSet, 0, nullptr);
-
-    // Set the Descriptor for HDR (Set: 2)
-    VkDescriptorSet hdrDescSet = resources.hdrIbl.getDescriptorSet();
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 2, 1, &hdrDescSet, 0, nullptr);
-
-    pushDescriptorSet(cmd, resources, VK_PIPELINE_BIND_POINT_COMPUTE);
+    bindComputeDescriptorSets(cmd, resources);
 
     // Dispatch the compute shader
     VkExtent2D numGroups = nvvk::getGroupCounts(renderingSize, WORKGROUP_SIZE);
-    vkCmdDispatch(cmd, numGroups.width, numGroups.height, 1);
+    vkCmdDispatch(cmd, numGroups.width, numGroups.height, sampleSplit);
+  }
+  else if(m_renderTechnique == RenderTechnique::Wavefront)
+  {
+    auto timerSection = m_profiler->cmdFrameSection(cmd, "Path Trace (WF)");
+    renderWavefront(cmd, resources, renderingSize);
+  }
+  else if(m_renderTechnique == RenderTechnique::Persistent)
+  {
+    auto timerSection = m_profiler->cmdFrameSection(cmd, "Path Trace (PT)");
+
+    if(m_persistentPipeline == VK_NULL_HANDLE)
+    {
+      createPersistentPipeline(resources);
+    }
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_persistentPipeline);
+    bindComputeDescriptorSets(cmd, resources);
+
+    // A fixed grid, no larger than one workgroup per tile: the threads loop over the pixels
+    const VkExtent2D numTiles  = nvvk::getGroupCounts(renderingSize, WORKGROUP_SIZE);
+    const uint32_t   numGroups = std::min(uint32_t(std::max(m_persistentGroups, 1)), numTiles.width * numTiles.height);
+    vkCmdDispatch(cmd, numGroups, 1, 1);
   }
   else  // RayTracing
   {
@@ -431,9 +754,53 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
 
 
     vkCmdTraceRaysKHR(cmd, &m_sbtRegions.raygen, &m_sbtRegions.miss, &m_sbtRegions.hit, &m_sbtRegions.callable,
-                      renderingSize.width, renderingSize.height, 1);
+                      renderingSize.width, renderingSize.height, sampleSplit);
   }
 
+  // Sample split: the partial sums of every pixel into the image
+  if(sampleSplit > 1)
+  {
+    auto timerSection = m_profiler->cmdFrameSection(cmd, "Sample Split Resolve");
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    if(m_splitResolvePipeline == VK_NULL_HANDLE)
+    {
+      createSplitResolvePipeline(resources);
+    }
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_splitResolvePipeline);
+    bindComputeDescriptorSets(cmd, resources);
+    VkExtent2D numGroups = nvvk::getGroupCounts(renderingSize, WORKGROUP_SIZE);
+    vkCmdDispatch(cmd, numGroups.width, numGroups.height, 1);
+  }
+
+  // Lane and light statistics of this frame, read back LANE_STATS_LATENCY frames later
+  if(m_laneStats || m_lightStatsActive)
+  {
+    m_lightStatsSlots[m_laneStatsFrame % LANE_STATS_LATENCY] = m_lightStatsActive ? m_lightStatsRender : 0;
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                           VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    const VkBufferCopy region{.srcOffset = 0,
+                              .dstOffset = (m_laneStatsFrame % LANE_STATS_LATENCY) * PATHTRACE_COUNTERS * sizeof(uint32_t),
+                              .size      = PATHTRACE_COUNTERS * sizeof(uint32_t)};
+    vkCmdCopyBuffer(cmd, m_pathtraceCounters.buffer, m_laneStatsReadback.buffer, 1, &region);
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_HOST_BIT,
+                           VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    m_laneStatsFrame++;
+  }
+
+  // Error of every tile from the pixel statistics of this frame, samples of the next frame
+  if(isAdaptivePixelsEnabled() && frameComplete)
+  {
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    dispatchAdaptiveTiles(cmd, resources, imageSize);
+  }
+
+  // End of the call for the cost model, with its work (samples x megapixels of the slice)
+  vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_timestampPool, 2 * timestampSlot + 1);
+  m_callWork[timestampSlot] = double(m_pushConst.numSamples) * double(renderingSize.width) * double(renderingSize.height) * 1e-6;
+  m_callIndex++;
+
   // Making sure the rendered image is ready to be used by tonemapper
   nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
 
@@ -478,9 +845,8 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
     // Time elapsed for this frame (wall-clock time from user perspective)
     float wallClockFrameTime = ImGui::GetIO().DeltaTime;
 
-    // Total number of pixels in the image
-    VkExtent2D imageSize   = resources.gBuffers.getSize();
-    uint64_t   totalPixels = static_cast<uint64_t>(imageSize.width) * static_cast<uint64_t>(imageSize.height);
+    // Number of pixels rendered in this call (a slice of the image with time slicing)
+    uint64_t totalPixels = static_cast<uint64_t>(renderingSize.width) * static_cast<uint64_t>(renderingSize.height);
 
     // Calculate mega-sample-pixels per second of wall-clock time
     // This tells the user how much rendering work is being done per real-world second
@@ -527,8 +893,37 @@ void PathTracer::pushDescriptorSet(VkCommandBuffer cmd, Resources& resources, Vk
   // Add QOLDS sampling buffers
   VkDescriptorBufferInfo qoldsMatricesInfo{resources.bQoldsMatrices.buffer, 0, VK_WHOLE_SIZE};
   VkDescriptorBufferInfo qoldsSeedsInfo{resources.bQoldsSeeds.buffer, 0, VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo qoldsTableInfo{resources.bQoldsTable.buffer, 0, VK_WHOLE_SIZE};
+  VkDescriptorBufferInfo qoldsScrambleTreeInfo{resources.bQoldsScrambleTree.buffer, 0, VK_WHOLE_SIZE};
   write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eQoldsMatrices), &qoldsMatricesInfo);
   write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eQoldsSeeds), &qoldsSeedsInfo);
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eQoldsTable), &qoldsTableInfo);
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eQoldsScrambleTree), &qoldsScrambleTreeInfo);
+
+  // Add Sobol'-Owen sampling buffer
+  VkDescriptorBufferInfo sobolMatricesInfo{resources.bSobolMatrices.buffer, 0, VK_WHOLE_SIZE};
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eSobolMatrices), &sobolMatricesInfo);
+
+  // Wavefront counters, only allocated for RenderTechnique::Wavefront
+  VkDescriptorBufferInfo wavefrontCountersInfo{m_wfCounters.buffer, 0, VK_WHOLE_SIZE};
+  if(m_wfCounters.buffer != VK_NULL_HANDLE)
+    write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eWavefrontCounters), &wavefrontCountersInfo);
+
+  VkDescriptorBufferInfo adaptiveErrorSumsInfo{m_adaptiveErrorSums.buffer, 0, VK_WHOLE_SIZE};
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eAdaptiveErrorSums), &adaptiveErrorSumsInfo);
+
+  VkDescriptorBufferInfo pathtraceCountersInfo{m_pathtraceCounters.buffer, 0, VK_WHOLE_SIZE};
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::ePathtraceCounters), &pathtraceCountersInfo);
+
+  // Light selection: power-weighted alias table, light BVH and emissive triangles
+  VkDescriptorBufferInfo lightAliasInfo{resources.bLightAlias.buffer, 0, VK_WHOLE_SIZE};
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eLightAlias), &lightAliasInfo);
+  VkDescriptorBufferInfo lightTreeInfo{resources.bLightTree.buffer, 0, VK_WHOLE_SIZE};
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eLightTree), &lightTreeInfo);
+  VkDescriptorBufferInfo emissiveTrianglesInfo{resources.bEmissiveTriangles.buffer, 0, VK_WHOLE_SIZE};
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eEmissiveTriangles), &emissiveTrianglesInfo);
+  VkDescriptorBufferInfo emissiveNodesInfo{resources.bEmissiveNodes.buffer, 0, VK_WHOLE_SIZE};
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eEmissiveNodes), &emissiveNodesInfo);
 
   vkCmdPushDescriptorSetKHR(cmd, bindPoint, m_pipelineLayout, 1, write.size(), write.data());
 }
@@ -568,6 +963,13 @@ void PathTracer::createRqPipeline(Resources& resources)
       .pName  = "computeMain",
   };
 
+  // Sampler backend, lane statistics
+  nvvk::Specialization specialization;
+  specialization.add(0, 0);
+  specialization.add(1, static_cast<int32_t>(m_samplerType));
+  specialization.add(2, m_laneStats ? 1 : 0);
+  shaderStage.pSpecializationInfo = specialization.getSpecializationInfo();
+
   VkComputePipelineCreateInfo cpCreateInfo{
       .sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
       .stage  = shaderStage,
@@ -579,6 +981,311 @@ void PathTracer::createRqPipeline(Resources& resources)
   NVVK_DBG_NAME(m_rqPipeline);
 }
 
+//--------------------------------------------------------------------------------------------------
+// Create the compute pipeline of the persistent threads (persistentMain), same module and layout
+void PathTracer::createPersistentPipeline(Resources& resources)
+{
+  SCOPED_TIMER(__FUNCTION__);
+
+  // Sampler backend, lane statistics
+  nvvk::Specialization specialization;
+  specialization.add(0, 0);
+  specialization.add(1, static_cast<int32_t>(m_samplerType));
+  specialization.add(2, m_laneStats ? 1 : 0);
+
+  VkComputePipelineCreateInfo cpCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .stage =
+          {
+              .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+              .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+              .module              = m_shaderModule,
+              .pName               = "persistentMain",
+              .pSpecializationInfo = specialization.getSpecializationInfo(),
+          },
+      .layout = m_pipelineLayout,
+  };
+  NVVK_CHECK(vkCreateComputePipelines(m_device, m_pipelineCache.getCache(), 1, &cpCreateInfo, nullptr, &m_persistentPipeline));
+  NVVK_DBG_NAME(m_persistentPipeline);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the compute pipeline adding up the sample split of every pixel (splitResolveMain)
+void PathTracer::createSplitResolvePipeline(Resources& resources)
+{
+  SCOPED_TIMER(__FUNCTION__);
+
+  // Sampler backend
+  nvvk::Specialization specialization;
+  specialization.add(0, 0);
+  specialization.add(1, static_cast<int32_t>(m_samplerType));
+
+  VkComputePipelineCreateInfo cpCreateInfo{
+      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .stage =
+          {
+              .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+              .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+              .module              = m_shaderModule,
+              .pName               = "splitResolveMain",
+              .pSpecializationInfo = specialization.getSpecializationInfo(),
+          },
+      .layout = m_pipelineLayout,
+  };
+  NVVK_CHECK(vkCreateComputePipelines(m_device, m_pipelineCache.getCache(), 1, &cpCreateInfo, nullptr, &m_splitResolvePipeline));
+  NVVK_DBG_NAME(m_splitResolvePipeline);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the compute pipelines of ReSTIR DI (restir_di.h.slang), same module and layout
+void PathTracer::createRestirPipelines(Resources& resources)
+{
+  SCOPED_TIMER(__FUNCTION__);
+
+  // Sampler backend
+  nvvk::Specialization specialization;
+  specialization.add(0, 0);
+  specialization.add(1, static_cast<int32_t>(m_samplerType));
+
+  const std::array<std::pair<const char*, VkPipeline*>, 2> kernels = {{
+      {"restirCandidatesMain", &m_restirCandidatesPipeline},
+      {"restirSpatialMain", &m_restirSpatialPipeline},
+  }};
+  for(const auto& [entry, pipeline] : kernels)
+  {
+    VkComputePipelineCreateInfo cpCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage =
+            {
+                .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module              = m_shaderModule,
+                .pName               = entry,
+                .pSpecializationInfo = specialization.getSpecializationInfo(),
+            },
+        .layout = m_pipelineLayout,
+    };
+    NVVK_CHECK(vkCreateComputePipelines(m_device, m_pipelineCache.getCache(), 1, &cpCreateInfo, nullptr, pipeline));
+    NVVK_DBG_NAME(*pipeline);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the compute pipelines of the wavefront kernels (wavefront.h.slang), same module and layout
+void PathTracer::createWavefrontPipelines(Resources& resources)
+{
+  SCOPED_TIMER(__FUNCTION__);
+
+  const std::array<const char*, eWfKernelCount> entryPoints = {"wfGenerateMain", "wfPrepareMain",  "wfExtendMain",
+                                                               "wfSortMain",     "wfShadeMain",    "wfConnectMain",
+                                                               "wfAccumulateMain"};
+
+  // Sampler backend
+  nvvk::Specialization specialization;
+  specialization.add(0, 0);
+  specialization.add(1, static_cast<int32_t>(m_samplerType));
+
+  for(int kernel = 0; kernel < eWfKernelCount; kernel++)
+  {
+    VkComputePipelineCreateInfo cpCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage =
+            {
+                .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module              = m_shaderModule,
+                .pName               = entryPoints[kernel],
+                .pSpecializationInfo = specialization.getSpecializationInfo(),
+            },
+        .layout = m_pipelineLayout,
+    };
+    NVVK_CHECK(vkCreateComputePipelines(m_device, m_pipelineCache.getCache(), 1, &cpCreateInfo, nullptr, &m_wfPipelines[kernel]));
+    NVVK_DBG_NAME(m_wfPipelines[kernel]);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Allocate the wavefront queues: the path state of every pixel and the ray, hit and shadow queues,
+// as structures of arrays so that the lanes of a kernel read contiguous memory
+void PathTracer::createWavefrontBuffers(Resources& resources, uint32_t numPaths, uint32_t numKeys)
+{
+  destroyWavefrontBuffers(resources);
+  m_wfNumPaths = numPaths;
+  m_wfNumKeys  = numKeys;
+
+  // All arrays in one buffer, 256-byte aligned: laid out from address 0 to size the buffer,
+  // then again from the address of the buffer
+  shaderio::WavefrontQueues queues{};
+  auto                      layout = [&](VkDeviceAddress base) {
+    VkDeviceSize offset = 0;
+    auto         place  = [&](auto*& array, uint32_t count) {
+      using Element = std::remove_reference_t<decltype(*array)>;
+      array         = reinterpret_cast<Element*>(base + offset);
+      offset += (VkDeviceSize(count) * sizeof(Element) + 255) & ~VkDeviceSize(255);
+    };
+    place(queues.pathOrigin, numPaths);
+    place(queues.pathDirection, numPaths);
+    place(queues.pathThroughput, numPaths);
+    place(queues.pathRadiance, numPaths);
+    place(queues.pathMaxRoughness, numPaths);
+    place(queues.pathFlags, numPaths);
+    place(queues.pathSeed, numPaths);
+    place(queues.rayQueue0, numPaths);
+    place(queues.rayQueue1, numPaths);
+    place(queues.hitPath, numPaths);
+    place(queues.hitInstance, numPaths);
+    place(queues.hitPrimitive, numPaths);
+    place(queues.hitTriangle, numPaths);
+    place(queues.hitBarycentrics, numPaths);
+    place(queues.hitT, numPaths);
+    place(queues.hitKey, numPaths);
+    place(queues.hitSorted, numPaths);
+    place(queues.shadowPath, numPaths);
+    place(queues.shadowOrigin, numPaths);
+    place(queues.shadowDirection, numPaths);
+    place(queues.shadowContribution, numPaths);
+    return offset;
+  };
+
+  const VkDeviceSize queuesSize = layout(0);
+  NVVK_CHECK(resources.allocator.createBuffer(m_wfQueues, queuesSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                              VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE));
+  NVVK_DBG_NAME(m_wfQueues.buffer);
+  layout(m_wfQueues.address);
+  queues.numPaths = numPaths;
+  queues.numKeys  = numKeys;
+
+  // The addresses do not change until the next allocation: written once through the mapping
+  NVVK_CHECK(resources.allocator.createBuffer(m_wfHeader, sizeof(queues), VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                              VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+                                              VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+  NVVK_DBG_NAME(m_wfHeader.buffer);
+  std::memcpy(m_wfHeader.mapping, &queues, sizeof(queues));
+
+  // Counters and indirect arguments, then the count and the scatter cursor of every material key
+  const VkDeviceSize countersSize = (WAVEFRONT_KEY_COUNTS + 2 * VkDeviceSize(numKeys)) * sizeof(uint32_t);
+  NVVK_CHECK(resources.allocator.createBuffer(m_wfCounters, countersSize,
+                                              VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_INDIRECT_BUFFER_BIT
+                                                  | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                              VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_wfCounters.buffer);
+
+  LOGI("Wavefront queues: %u paths, %u material keys, %.1f MB\n", numPaths, numKeys, double(queuesSize) / (1024.0 * 1024.0));
+}
+
+void PathTracer::destroyWavefrontBuffers(Resources& resources)
+{
+  resources.allocator.destroyBuffer(m_wfQueues);
+  resources.allocator.destroyBuffer(m_wfHeader);
+  resources.allocator.destroyBuffer(m_wfCounters);
+  m_wfNumPaths = 0;
+  m_wfNumKeys  = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bind the descriptor sets of the compute pipelines: TLAS, output image, textures, etc. (Set: 0),
+// HDR (Set: 2), and push the set 1
+void PathTracer::bindComputeDescriptorSets(VkCommandBuffer cmd, Resources& resources) const
+{
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &resources.descriptorSet, 0, nullptr);
+  VkDescriptorSet hdrDescSet = resources.hdrIbl.getDescriptorSet();
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 2, 1, &hdrDescSet, 0, nullptr);
+  pushDescriptorSet(cmd, resources, VK_PIPELINE_BIND_POINT_COMPUTE);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Wavefront path tracing: for every sample of the frame, the camera rays, then every bounce as
+// extend, sort, shade and connect dispatches, sized on the GPU by wfPrepareMain (indirect dispatch)
+void PathTracer::renderWavefront(VkCommandBuffer cmd, Resources& resources, const VkExtent2D& size)
+{
+  // One path per pixel, one material key per material plus the infinite plane
+  const uint32_t numPaths = size.width * size.height;
+  const uint32_t numKeys  = uint32_t(std::max<size_t>(resources.scene.getModel().materials.size(), 1)) + 1;
+  if(numPaths != m_wfNumPaths || numKeys != m_wfNumKeys)
+  {
+    vkDeviceWaitIdle(m_device);  // The queues may be in use by a frame in flight
+    createWavefrontBuffers(resources, numPaths, numKeys);
+  }
+
+  if(m_wfPipelines[eWfGenerate] == VK_NULL_HANDLE)
+  {
+    createWavefrontPipelines(resources);
+  }
+
+  bindComputeDescriptorSets(cmd, resources);
+
+  m_pushConst.wavefront = (shaderio::WavefrontQueues*)m_wfHeader.address;
+
+  auto bindKernel = [&](WavefrontKernel kernel, shaderio::WavefrontStage stage) {
+    m_pushConst.wavefrontStage = stage;
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_wfPipelines[kernel]);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(shaderio::PathtracePushConstant), &m_pushConst);
+  };
+  auto dispatchIndirect = [&](uint32_t argsOffset) {
+    vkCmdDispatchIndirect(cmd, m_wfCounters.buffer, argsOffset * sizeof(uint32_t));
+  };
+  // Every kernel reads the queues of the previous one, and the arguments written by wfPrepareMain
+  auto barrier = [&]() {
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+  };
+
+  // With per-pixel adaptive sampling a tile may take more samples than numSamples: the pixels
+  // done with their samples queue no ray, and the dispatches of the empty queues have no workgroups
+  const int numSamples = isAdaptivePixelsEnabled() ? ADAPTIVE_MAX_SAMPLE_SCALE * m_pushConst.numSamples : m_pushConst.numSamples;
+
+  const VkExtent2D pixelGroups = nvvk::getGroupCounts(size, WORKGROUP_SIZE);
+  for(int sample = 0; sample < numSamples; sample++)
+  {
+    m_pushConst.wavefrontSample = sample;
+    m_pushConst.wavefrontDepth  = 0;
+
+    // All counters to zero, after the previous sample (or frame) is done with them
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                           VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    vkCmdFillBuffer(cmd, m_wfCounters.buffer, 0, VK_WHOLE_SIZE, 0);
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+    bindKernel(eWfGenerate, shaderio::eWavefrontExtend);
+    vkCmdDispatch(cmd, pixelGroups.width, pixelGroups.height, 1);
+    barrier();
+
+    // The queues empty out as paths end; the dispatches of an empty queue have no workgroups
+    for(int depth = 0; depth < m_pushConst.maxDepth; depth++)
+    {
+      m_pushConst.wavefrontDepth = depth;
+
+      bindKernel(eWfPrepare, shaderio::eWavefrontExtend);
+      vkCmdDispatch(cmd, 1, 1, 1);
+      barrier();
+      bindKernel(eWfExtend, shaderio::eWavefrontExtend);
+      dispatchIndirect(WAVEFRONT_EXTEND_ARGS);
+      barrier();
+
+      bindKernel(eWfPrepare, shaderio::eWavefrontShade);
+      vkCmdDispatch(cmd, 1, 1, 1);
+      barrier();
+      bindKernel(eWfSort, shaderio::eWavefrontShade);
+      dispatchIndirect(WAVEFRONT_SHADE_ARGS);
+      barrier();
+      bindKernel(eWfShade, shaderio::eWavefrontShade);
+      dispatchIndirect(WAVEFRONT_SHADE_ARGS);
+      barrier();
+
+      bindKernel(eWfPrepare, shaderio::eWavefrontConnect);
+      vkCmdDispatch(cmd, 1, 1, 1);
+      barrier();
+      bindKernel(eWfConnect, shaderio::eWavefrontConnect);
+      dispatchIndirect(WAVEFRONT_CONNECT_ARGS);
+      barrier();
+    }
+
+    bindKernel(eWfAccumulate, shaderio::eWavefrontExtend);
+    vkCmdDispatch(cmd, pixelGroups.width, pixelGroups.height, 1);
+    barrier();
+  }
+}
+
 
 //--------------------------------------------------------------------------------------------------
 // Create the RTX pipeline
@@ -669,6 +1376,7 @@ void PathTracer::createRtxPipeline(Resources& resources)
   // Shader Execution Reorder (SER)
   nvvk::Specialization specialization;
   specialization.add(0, m_useSER ? 1 : 0);
+  specialization.add(1, static_cast<int32_t>(m_samplerType));  // Sampler backend
   stages[eRaygen].pSpecializationInfo = specialization.getSpecializationInfo();
 
 
@@ -771,15 +1479,187 @@ void PathTracer::compileShader(Resources& resources, bool fromFile)
   }
 
   // Destroy pipeline since there is a new shader
+  destroyPipelines();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the pipelines of all techniques, they are recreated when used
+void PathTracer::destroyPipelines()
+{
   vkDestroyPipeline(m_device, m_rtxPipeline, nullptr);
   m_rtxPipeline = VK_NULL_HANDLE;
   vkDestroyPipeline(m_device, m_rqPipeline, nullptr);
   m_rqPipeline = VK_NULL_HANDLE;
+  vkDestroyPipeline(m_device, m_persistentPipeline, nullptr);
+  m_persistentPipeline = VK_NULL_HANDLE;
+  vkDestroyPipeline(m_device, m_splitResolvePipeline, nullptr);
+  m_splitResolvePipeline = VK_NULL_HANDLE;
+  for(VkPipeline& pipeline : m_wfPipelines)
+  {
+    vkDestroyPipeline(m_device, pipeline, nullptr);
+    pipeline = VK_NULL_HANDLE;
+  }
+  vkDestroyPipeline(m_device, m_adaptivePipeline, nullptr);
+  m_adaptivePipeline = VK_NULL_HANDLE;
+  vkDestroyPipeline(m_device, m_restirCandidatesPipeline, nullptr);
+  m_restirCandidatesPipeline = VK_NULL_HANDLE;
+  vkDestroyPipeline(m_device, m_restirSpatialPipeline, nullptr);
+  m_restirSpatialPipeline = VK_NULL_HANDLE;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+// Samples per pixel of a complete render: maxFrames iterations of the per-frame sample count.
+// With Auto SPP or Adaptive Pixels the per-frame count is not known in advance, so the largest one is assumed.
+uint64_t PathTracer::getSampleBudget(const Resources& resources) const
+{
+  int samplesPerFrame = m_adaptiveSampling ? MAX_SAMPLES_PER_PIXEL : m_pushConst.numSamples;
+  if(m_adaptivePixels)
+    samplesPerFrame *= ADAPTIVE_MAX_SAMPLE_SCALE;  // The noisiest tiles take more samples than the frame's count
+  return uint64_t(std::max(resources.settings.maxFrames, 1)) * uint64_t(std::max(samplesPerFrame, 1));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Camera dimensions, then one block of dimensions per bounce
+static_assert(SAMPLER_CAMERA_DIMENSIONS % SOBOL_GROUP_DIMENSIONS == 0 && SAMPLER_BOUNCE_DIMENSIONS % SOBOL_GROUP_DIMENSIONS == 0,
+              "The decisions of a path sample must not straddle the Sobol' groups (path_sampler.h.slang)");
+int PathTracer::getSampleDimensions() const
+{
+  return SAMPLER_CAMERA_DIMENSIONS + std::max(m_pushConst.maxDepth, 1) * SAMPLER_BOUNCE_DIMENSIONS;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame time model of the current scene, technique and path settings
+std::string PathTracer::getSampleCostKey(const Resources& resources) const
+{
+  return nvutils::utf8FromPath(resources.scene.getFilename()) + "|" + std::to_string(int(m_renderTechnique)) + "|"
+         + std::to_string(int(m_samplerType)) + "|" + std::to_string(m_pushConst.maxDepth) + "|" + std::to_string(int(m_useSER));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Measure the cost of a sample: GPU ms per sample per megapixel of the path tracer. The time of a
+// whole call (timestamps) over the work of the same call, so that the short last slice of a frame
+// and the passes that run once per frame are measured like the others.
+void PathTracer::measureSampleCost(Resources& resources)
+{
+  constexpr double kCostSmoothing = 0.3;  // Weight of a new measurement in the cost
+  constexpr double kCostJump      = 0.5;  // Relative change of the cost taken at once (new view)
+
+  // The call of this slot, LANE_STATS_LATENCY calls ago, is about to be overwritten by this one
+  const uint32_t slot = m_callIndex % LANE_STATS_LATENCY;
+  const double   work = m_callWork[slot];
+  m_callWork[slot]    = 0.0;
+  if(work <= 0.0 || isDlssEnabled())
+    return;
+
+  uint64_t timestamps[2] = {};
+  if(vkGetQueryPoolResults(m_device, m_timestampPool, 2 * slot, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                           VK_QUERY_RESULT_64_BIT)
+         != VK_SUCCESS
+     || timestamps[1] <= timestamps[0])
+    return;
+
+  const double callTimeMs = double(timestamps[1] - timestamps[0]) * m_timestampPeriodNs * 1e-6;
+  double&      cost       = m_sampleCostMs[getSampleCostKey(resources)];
+  const double measured   = callTimeMs / work;
+  if(cost <= 0.0 || std::abs(measured - cost) > kCostJump * cost)
+    cost = measured;
+  else
+    cost += kCostSmoothing * (measured - cost);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Lane statistics: the counters copied LANE_STATS_LATENCY frames ago, which the GPU is done with,
+// are about to be overwritten by this frame
+void PathTracer::readLaneStats()
+{
+  if(m_laneStatsFrame < LANE_STATS_LATENCY)
+    return;
+
+  const uint32_t  slot     = m_laneStatsFrame % LANE_STATS_LATENCY;
+  const uint32_t* counters = static_cast<const uint32_t*>(m_laneStatsReadback.mapping) + slot * PATHTRACE_COUNTERS;
+  if(m_laneStats && counters[PATHTRACE_WAVE_LANES] > 0)
+  {
+    m_laneOccupancyRollingAvg.addValue(100.0f * float(counters[PATHTRACE_ACTIVE_LANES]) / float(counters[PATHTRACE_WAVE_LANES]));
+  }
+
+  // Light statistics of the current render, read once
+  if(m_lightStatsSlots[slot] != 0 && m_lightStatsSlots[slot] == m_lightStatsRender)
+  {
+    for(int t = 0; t < shaderio::eLightTechniqueCount; t++)
+    {
+      const uint32_t low  = counters[PATHTRACE_LIGHT_STATS + 2 * t];
+      const uint32_t high = counters[PATHTRACE_LIGHT_STATS + 2 * t + 1];
+      m_lightStatsSums[t] += (double(high) * 4294967296.0 + double(low)) / LIGHT_STATS_FIXED_POINT;
+    }
+  }
+  m_lightStatsSlots[slot] = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Light selection probabilities from the light statistics: every technique is chosen in proportion to
+// its contribution, which counts the occlusion the power misses (the sun of an interior). A new render
+// measures again, keeping the probabilities learned so far until its statistics arrive.
+void PathTracer::updateLightSelect(Resources& resources)
+{
+  if(resources.frameCount == 0)
+  {
+    m_lightStatsRender++;
+    m_lightStatsSums = {};
+  }
+  m_lightStatsActive = m_adaptiveLightSelect && resources.frameCount < LIGHT_STATS_FRAMES;
+  if(!m_adaptiveLightSelect)
+  {
+    resources.lightSelectLearned    = -1.0f;
+    resources.emissiveSelectLearned = -1.0f;
+    return;
+  }
+
+  // Each sum estimates the contribution of its technique: the samples are divided by their selection
+  // probability. The minimum share keeps every technique measured, and the estimate unbiased.
+  const double environment = m_lightStatsSums[shaderio::eLightTechniqueEnvironment];
+  const double punctual    = m_lightStatsSums[shaderio::eLightTechniquePunctual];
+  const double emissive    = m_lightStatsSums[shaderio::eLightTechniqueEmissive];
+  if(punctual + emissive + environment > 0.0)
+  {
+    resources.lightSelectLearned = std::clamp(float((punctual + emissive) / (punctual + emissive + environment)),
+                                              LIGHT_SELECT_MIN_PROBABILITY, 1.0f - LIGHT_SELECT_MIN_PROBABILITY);
+  }
+  if(punctual + emissive > 0.0)
+  {
+    resources.emissiveSelectLearned = std::clamp(float(emissive / (punctual + emissive)), LIGHT_SELECT_MIN_PROBABILITY,
+                                                 1.0f - LIGHT_SELECT_MIN_PROBABILITY);
+  }
 }
 
+//--------------------------------------------------------------------------------------------------
+// Throughput and lane occupancy of the render, logged once when it finishes (benchmarks)
+void PathTracer::logPerformance() const
+{
+  const char* techniques[]  = {"Ray Query", "Ray Tracing", "Wavefront", "Ray Query (Persistent)"};
+  const char* technique     = techniques[static_cast<int>(m_renderTechnique)];
+  const float msppPerSecond = m_throughputRollingAvg.getAverage();
+  if(msppPerSecond <= 0.0f)
+    return;
+  if(m_laneStats)
+  {
+    LOGI("Path tracer performance: %s, %.2f MSPP/s (%.2f ns per sample), lane occupancy %.1f%%\n", technique,
+         msppPerSecond, 1000.0f / msppPerSecond, m_laneOccupancyRollingAvg.getAverage());
+  }
+  else
+  {
+    LOGI("Path tracer performance: %s, %.2f MSPP/s (%.2f ns per sample)\n", technique, msppPerSecond, 1000.0f / msppPerSecond);
+  }
+}
 
 //--------------------------------------------------------------------------------------------------
 // Update adaptive sampling based on frame timing
+//
+// The GPU time of the path tracer is modeled as cost x samples per pixel x megapixels, the cost
+// being refined by every measurement (measureSampleCost). The sample count jumps to the one
+// predicted to fill the frame budget. It only changes when the predicted frame time leaves a band
+// around the target, so the count does not flicker. The cost is kept per scene and technique:
+// after a camera or scene reset the render restarts at the predicted count instead of the minimum.
 void PathTracer::updateAdaptiveSampling(Resources& resources)
 {
   // Don't update adaptive sampling if DLSS is enabled
@@ -789,43 +1669,322 @@ void PathTracer::updateAdaptiveSampling(Resources& resources)
   if(!m_adaptiveSampling || !m_profilerTimeline)
     return;
 
-  // Reset samples when frame count resets to 0 (scene change, etc.)
-  if(resources.frameCount == 0)
-  {
-    m_pushConst.numSamples = MIN_SAMPLES_PER_PIXEL;
+  constexpr double kBandLow  = 0.85;  // Predicted frame time kept between these fractions of the target
+  constexpr double kBandHigh = 1.05;
+
+  // No measurement yet for this scene: keep the current count
+  auto cost = m_sampleCostMs.find(getSampleCostKey(resources));
+  if(cost == m_sampleCostMs.end() || cost->second <= 0.0)
     return;
+
+  const VkExtent2D size       = resources.gBuffers.getSize();
+  const double     megapixels = std::max(double(size.width) * double(size.height) * 1e-6, 1e-6);
+  const double     targetTime = getTargetFrameTimeMs();
+  const double     predicted  = cost->second * double(m_pushConst.numSamples) * megapixels;
+  if(predicted < targetTime * kBandLow || predicted > targetTime * kBandHigh)
+  {
+    const int fitting      = int(std::floor(targetTime / (cost->second * megapixels)));
+    m_pushConst.numSamples = std::clamp(fitting, MIN_SAMPLES_PER_PIXEL, MAX_SAMPLES_PER_PIXEL);
   }
+}
 
-  // Don't adjust on the first few frames to allow for stabilization
-  if(resources.frameCount < 5)
-    return;
+//--------------------------------------------------------------------------------------------------
+// Time slicing: rows of the image rendered in one call, so that it fits the frame budget (the
+// performance target with Auto SPP, the slice budget otherwise). Whole rows of tiles, from the
+// cost model; a few rows until the cost of the scene is measured. The wavefront technique and
+// DLSS render whole frames.
+uint32_t PathTracer::getSliceRows(const Resources& resources, const VkExtent2D& size) const
+{
+  if(!m_timeSlicing || isDlssEnabled() || m_renderTechnique == RenderTechnique::Wavefront)
+    return size.height;
 
-  // Get timing information for the path tracing section
-  nvutils::ProfilerTimeline::TimerInfo timerInfo;
-  std::string                          apiName;
+  constexpr uint32_t kFirstSliceRows = 4 * WORKGROUP_SIZE;
 
-  // Try both possible timer names based on rendering technique
-  const char* timerName = (m_renderTechnique == RenderTechnique::RayQuery) ? "Path Trace (RQ)" : "Path Trace (RTX)";
+  auto cost = m_sampleCostMs.find(getSampleCostKey(resources));
+  if(cost == m_sampleCostMs.end() || cost->second <= 0.0)
+    return std::min(kFirstSliceRows, size.height);
+
+  const double budgetMs = m_adaptiveSampling ? getTargetFrameTimeMs() : double(m_sliceBudgetMs);
+  const double rowMs    = cost->second * double(m_pushConst.numSamples) * double(size.width) * 1e-6;
+  const double rows     = std::floor(budgetMs / rowMs / WORKGROUP_SIZE) * WORKGROUP_SIZE;
+  return uint32_t(std::clamp(rows, double(WORKGROUP_SIZE), double(size.height)));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sample split: on an image too small to fill the GPU with one thread per pixel, the samples of a
+// pixel are shared by up to SAMPLE_SPLIT_MAX threads (grid Z), each tracing at least one sample.
+// Ray query and ray tracing dispatches only.
+uint32_t PathTracer::getSampleSplit(const VkExtent2D& size) const
+{
+  if(!m_sampleSplit || (m_renderTechnique != RenderTechnique::RayQuery && m_renderTechnique != RenderTechnique::RayTracing))
+    return 1;
 
-  if(m_profilerTimeline->getFrameTimerInfo(timerName, timerInfo, apiName))
+  const uint64_t pixels = std::max(uint64_t(size.width) * size.height, uint64_t(1));
+  const uint64_t split  = std::min({SAMPLE_SPLIT_THREADS / pixels, uint64_t(SAMPLE_SPLIT_MAX), uint64_t(m_pushConst.numSamples)});
+  return uint32_t(std::max(split, uint64_t(1)));
+}
+
+//--------------------------------------------------------------------------------------------------
+// State of the frame: per-pixel adaptive sampling (and its buffers for the render size), the
+// image slice of the call, the sample split (and its partial sums), and the counters cleared
+void PathTracer::updateFrameState(VkCommandBuffer cmd, Resources& resources, const VkRect2D& slice, uint32_t sampleSplit)
+{
+  // The previous frame is done with the state, the error sums and the counters
+  nvvk::cmdMemoryBarrier(cmd,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR
+                             | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+
+  shaderio::PathtraceFrameState frameState{};
+  frameState.sliceOffset = glm::ivec2(slice.offset.x, slice.offset.y);
+  frameState.sliceSize   = glm::ivec2(slice.extent.width, slice.extent.height);
+  frameState.sampleSplit = int(sampleSplit);
+
+  frameState.lightTree         = m_lightTree ? 1 : 0;
+  frameState.lightTreeNodes    = resources.lightTreeNodes;
+  frameState.lightTreeInfinite = resources.lightTreeInfinite;
+  frameState.emissiveTriangles = m_emissiveLights ? resources.emissiveTriangles : 0;
+  frameState.lightStats        = m_lightStatsActive ? 1 : 0;
+  if(sampleSplit > 1)
   {
-    // Convert from microseconds to milliseconds
-    double currentFrameTimeMs = timerInfo.gpu.last / 1000.0;
+    // Radiance sums of every split of every pixel, then their adaptive statistics
+    const VkExtent2D   size        = resources.gBuffers.getSize();
+    const VkDeviceSize partialSize = VkDeviceSize(sampleSplit) * size.width * size.height * sizeof(glm::vec4)
+                                     * (isAdaptivePixelsEnabled() ? 2 : 1);
+    if(partialSize > m_splitPartialsSize)
+    {
+      vkDeviceWaitIdle(m_device);  // The partial sums may be in use by a frame in flight
+      resources.allocator.destroyBuffer(m_splitPartials);
+      NVVK_CHECK(resources.allocator.createBuffer(m_splitPartials, partialSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                                  VMA_MEMORY_USAGE_GPU_ONLY));
+      NVVK_DBG_NAME(m_splitPartials.buffer);
+      m_splitPartialsSize = partialSize;
+    }
+    frameState.splitPartials = reinterpret_cast<decltype(frameState.splitPartials)>(m_splitPartials.address);
+  }
+  vkCmdFillBuffer(cmd, m_pathtraceCounters.buffer, 0, VK_WHOLE_SIZE, 0);
 
-    // Adjust samples based on performance target
-    double targetTime = getTargetFrameTimeMs();
-    if(currentFrameTimeMs < targetTime * 0.8 && m_pushConst.numSamples < MAX_SAMPLES_PER_PIXEL)
+  shaderio::RestirState& restir = frameState.restir;
+  if(isRestirEnabled())
+  {
+    const VkExtent2D size = resources.gBuffers.getSize();
+    if(size.width != m_restirSize.width || size.height != m_restirSize.height)
     {
-      // We have headroom, increase samples
-      m_pushConst.numSamples++;
+      vkDeviceWaitIdle(m_device);  // The reservoirs may be in use by a frame in flight
+      createRestirBuffers(resources, size);
     }
-    else if(currentFrameTimeMs > targetTime * 1.1 && m_pushConst.numSamples > MIN_SAMPLES_PER_PIXEL)
+
+    const VkDeviceSize reservoirsSize = 2 * VkDeviceSize(size.width) * size.height * sizeof(shaderio::RestirReservoir);
+    restir.reservoirs     = reinterpret_cast<decltype(restir.reservoirs)>(m_restirBuffer.address);
+    restir.surfaces       = reinterpret_cast<decltype(restir.surfaces)>(m_restirBuffer.address + reservoirsSize);
+    restir.enabled        = 1;
+    restir.candidates     = std::max(m_restirCandidates, 1);
+    restir.temporal       = m_restirTemporal ? 1 : 0;
+    restir.spatialSamples = std::max(m_restirSpatialSamples, 0);
+    restir.spatialRadius  = m_restirSpatialRadius;
+    restir.historyValid   = m_restirHistoryValid ? 1 : 0;
+    restir.frame          = m_restirFrame;
+  }
+
+  shaderio::GuidingState& guiding = frameState.guiding;
+  if(isGuidingEnabled() && m_guidingActive)
+  {
+    // The records of an iteration fill half of the buffer: the sample count of the later frames may grow
+    const VkExtent2D size     = resources.gBuffers.getSize();
+    const double     vertices = double(GUIDING_PATH_VERTICES) * size.width * size.height * m_frameNumSamples
+                            * double(1u << std::min(m_guidingIteration, 30));  // Vertices of the iteration
+    guiding.spatialNodes      = reinterpret_cast<decltype(guiding.spatialNodes)>(m_guidingTree.address);
+    guiding.directionalNodes  = reinterpret_cast<decltype(guiding.directionalNodes)>(m_guidingTree.address + m_guidingDirectionalOffset);
+    guiding.records           = reinterpret_cast<decltype(guiding.records)>(m_guidingRecords.address + GUIDING_RECORDS_OFFSET);
+    guiding.recordCount       = reinterpret_cast<decltype(guiding.recordCount)>(m_guidingRecords.address);
+    guiding.boundsMin         = m_guidingBuilder.getBoundsMin();
+    guiding.boundsSize        = m_guidingBuilder.getBoundsSize();
+    guiding.enabled           = m_guidingBuilder.hasDistribution() ? 1 : 0;
+    guiding.recordProbability = float(std::min(1.0, 0.5 * GUIDING_MAX_RECORDS / std::max(vertices, 1.0)));
+  }
+
+  shaderio::AdaptiveSampling& adaptive = frameState.adaptive;
+  if(isAdaptivePixelsEnabled())
+  {
+    const VkExtent2D size = resources.gBuffers.getSize();
+    if(size.width != m_adaptiveSize.width || size.height != m_adaptiveSize.height)
     {
-      // We're over budget, decrease samples
-      m_pushConst.numSamples--;
+      vkDeviceWaitIdle(m_device);  // The statistics may be in use by a frame in flight
+      createAdaptiveBuffers(resources, size);
     }
 
-    // Clamp to valid range
-    m_pushConst.numSamples = std::clamp(m_pushConst.numSamples, MIN_SAMPLES_PER_PIXEL, MAX_SAMPLES_PER_PIXEL);
+    const VkDeviceSize statsSize = VkDeviceSize(size.width) * size.height * sizeof(glm::vec4);
+    adaptive.pixelStats          = reinterpret_cast<decltype(adaptive.pixelStats)>(m_adaptiveStats.address);
+    adaptive.tileSamples         = reinterpret_cast<decltype(adaptive.tileSamples)>(m_adaptiveStats.address + statsSize);
+    adaptive.tilesX              = nvvk::getGroupCounts(size, WORKGROUP_SIZE).width;
+    adaptive.enabled             = 1;
+    adaptive.threshold           = m_noiseThreshold;
+    adaptive.minSamples          = m_adaptiveMinSamples;
+
+    // adaptiveTilesMain() sums the errors of this frame in the slot of its parity
+    const VkDeviceSize slotSize = 2 * sizeof(uint32_t);
+    vkCmdFillBuffer(cmd, m_adaptiveErrorSums.buffer, (resources.frameCount & 1) * slotSize, slotSize, 0);
+  }
+  vkCmdUpdateBuffer(cmd, m_frameState.buffer, 0, sizeof(frameState), &frameState);
+
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR);
+}
+
+void PathTracer::createAdaptiveBuffers(Resources& resources, const VkExtent2D& size)
+{
+  resources.allocator.destroyBuffer(m_adaptiveStats);
+  m_adaptiveSize = size;
+
+  // float4 statistics per pixel, then one sample count per tile. They are started over by the
+  // first frame of a render, so they need no clear.
+  const VkExtent2D   tiles     = nvvk::getGroupCounts(size, WORKGROUP_SIZE);
+  const VkDeviceSize statsSize = VkDeviceSize(size.width) * size.height * sizeof(glm::vec4);
+  NVVK_CHECK(resources.allocator.createBuffer(m_adaptiveStats, statsSize + VkDeviceSize(tiles.width) * tiles.height * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_adaptiveStats.buffer);
+}
+
+void PathTracer::createRestirBuffers(Resources& resources, const VkExtent2D& size)
+{
+  resources.allocator.destroyBuffer(m_restirBuffer);
+  m_restirSize         = size;
+  m_restirHistoryValid = false;
+
+  // Reservoirs of the candidates and final ones, surfaces of the last two frames. The first frame
+  // writes all of them before they are read.
+  const VkDeviceSize numPixels = VkDeviceSize(size.width) * size.height;
+  NVVK_CHECK(resources.allocator.createBuffer(m_restirBuffer,
+                                              2 * numPixels * (sizeof(shaderio::RestirReservoir) + sizeof(shaderio::RestirSurface)),
+                                              VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY));
+  NVVK_DBG_NAME(m_restirBuffer.buffer);
+}
+
+//--------------------------------------------------------------------------------------------------
+// ReSTIR DI of the frame, before the path tracer: candidates, visibility and temporal reuse of every
+// pixel, then the spatial reuse into the final reservoirs
+void PathTracer::dispatchRestir(VkCommandBuffer cmd, Resources& resources, const VkExtent2D& size)
+{
+  auto timerSection = m_profiler->cmdFrameSection(cmd, "ReSTIR DI");
+
+  if(m_restirCandidatesPipeline == VK_NULL_HANDLE)
+  {
+    createRestirPipelines(resources);
+  }
+  const VkExtent2D numGroups = nvvk::getGroupCounts(size, WORKGROUP_SIZE);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_restirCandidatesPipeline);
+  bindComputeDescriptorSets(cmd, resources);
+  vkCmdDispatch(cmd, numGroups.width, numGroups.height, 1);
+
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_restirSpatialPipeline);
+  vkCmdDispatch(cmd, numGroups.width, numGroups.height, 1);
+
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR);
+  m_restirHistoryValid = true;
+}
+
+void PathTracer::dispatchAdaptiveTiles(VkCommandBuffer cmd, Resources& resources, const VkExtent2D& size)
+{
+  auto timerSection = m_profiler->cmdFrameSection(cmd, "Adaptive Tiles");
+
+  if(m_adaptivePipeline == VK_NULL_HANDLE)
+  {
+    nvvk::Specialization specialization;
+    specialization.add(0, 0);
+    specialization.add(1, static_cast<int32_t>(m_samplerType));
+
+    VkComputePipelineCreateInfo cpCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage =
+            {
+                .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module              = m_shaderModule,
+                .pName               = "adaptiveTilesMain",
+                .pSpecializationInfo = specialization.getSpecializationInfo(),
+            },
+        .layout = m_pipelineLayout,
+    };
+    NVVK_CHECK(vkCreateComputePipelines(m_device, m_pipelineCache.getCache(), 1, &cpCreateInfo, nullptr, &m_adaptivePipeline));
+    NVVK_DBG_NAME(m_adaptivePipeline);
+  }
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_adaptivePipeline);
+  bindComputeDescriptorSets(cmd, resources);
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(shaderio::PathtracePushConstant), &m_pushConst);
+
+  const VkExtent2D numGroups = nvvk::getGroupCounts(size, WORKGROUP_SIZE);
+  vkCmdDispatch(cmd, numGroups.width, numGroups.height, 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Path guiding between the frames: a new render starts over with a single region and nothing learned,
+// sampling the BSDF only. At the end of an iteration, its records teach the SD-tree, which is refined
+// and uploaded for the next iteration, twice as long.
+void PathTracer::updateGuiding(VkCommandBuffer cmd, Resources& resources)
+{
+  if(!isGuidingEnabled())
+  {
+    m_guidingActive = false;
+    return;
+  }
+
+  if(m_guidingRecords.buffer == VK_NULL_HANDLE)
+  {
+    // Written by the shaders and read by the host once per iteration
+    NVVK_CHECK(resources.allocator.createBuffer(m_guidingRecords, GUIDING_RECORDS_OFFSET + GUIDING_MAX_RECORDS * sizeof(shaderio::GuidingRecord),
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                                VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+    NVVK_DBG_NAME(m_guidingRecords.buffer);
+  }
+
+  if(resources.frameCount == 0 || !m_guidingActive)
+  {
+    const nvutils::Bbox& bounds = resources.scene.getSceneBounds();
+    m_guidingBuilder.reset(bounds.min(), bounds.max());
+    m_guidingIteration    = 0;
+    m_guidingIterationEnd = 1;
+    m_guidingActive       = true;
+  }
+  else if(resources.frameCount >= m_guidingIterationEnd)
+  {
+    vkDeviceWaitIdle(m_device);  // The last frames of the iteration may still be appending records
+    const auto*    mapping = static_cast<const uint8_t*>(m_guidingRecords.mapping);
+    const uint32_t count   = std::min(*reinterpret_cast<const uint32_t*>(mapping), uint32_t(GUIDING_MAX_RECORDS));
+    m_guidingBuilder.refine(reinterpret_cast<const shaderio::GuidingRecord*>(mapping + GUIDING_RECORDS_OFFSET), count);
+    m_guidingIteration++;
+    m_guidingIterationEnd = 2 * m_guidingIterationEnd + 1;
+  }
+  else
+  {
+    return;  // The iteration goes on with the same trees
+  }
+
+  // The previous frames are done with the trees and the records
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  vkCmdFillBuffer(cmd, m_guidingRecords.buffer, 0, sizeof(uint32_t), 0);
+
+  const auto&        spatialNodes     = m_guidingBuilder.getSpatialNodes();
+  const auto&        directionalNodes = m_guidingBuilder.getDirectionalNodes();
+  const VkDeviceSize spatialSize      = spatialNodes.size() * sizeof(shaderio::GuidingSpatialNode);
+  const VkDeviceSize directionalSize  = directionalNodes.size() * sizeof(shaderio::GuidingDirectionalNode);
+  if(spatialSize + directionalSize > m_guidingTreeSize)
+  {
+    vkDeviceWaitIdle(m_device);  // The trees may be in use by a frame in flight
+    resources.allocator.destroyBuffer(m_guidingTree);
+    m_guidingTreeSize = std::max(2 * (spatialSize + directionalSize), VkDeviceSize(1) << 20);
+    NVVK_CHECK(resources.allocator.createBuffer(m_guidingTree, m_guidingTreeSize,
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY));
+    NVVK_DBG_NAME(m_guidingTree.buffer);
   }
+  m_guidingDirectionalOffset = spatialSize;
+  resources.staging.appendBuffer(m_guidingTree, 0, spatialSize, spatialNodes.data());
+  resources.staging.appendBuffer(m_guidingTree, spatialSize, directionalSize, directionalNodes.data());
+  resources.staging.cmdUploadAppended(cmd);
 }
@@ -19,6 +19,10 @@
 
 #pragma once
 
+#include <array>
+#include <string>
+#include <unordered_map>
+
 #include <glm/glm.hpp>
 
 // Shader Input/Output
@@ -27,6 +31,7 @@
 #include <nvvk/sbt_generator.hpp>
 #include <nvutils/profiler.hpp>
 #include "renderer_base.hpp"
+#include "guiding_tree_builder.hpp"
 #include "utils.hpp"
 #include "pipeline_cache_util.hpp"
 
@@ -45,7 +50,9 @@ public:
   enum class RenderTechnique
   {
     RayQuery,
-    RayTracing
+    RayTracing,
+    Wavefront,  // Compute kernels communicating through ray and hit queues (wavefront.h.slang)
+    Persistent  // Ray query with persistent threads pulling pixels from a global counter
   };
 
   void onAttach(Resources& resources, nvvk::ProfilerGpuTimer* profiler) override;
@@ -60,17 +67,33 @@ public:
   void createPipeline(Resources& resources) override;
   void createRqPipeline(Resources& resources);
   void createRtxPipeline(Resources& resources);
+  void createPersistentPipeline(Resources& resources);
+  void createSplitResolvePipeline(Resources& resources);
+  void createRestirPipelines(Resources& resources);
+  void createWavefrontPipelines(Resources& resources);
+  void destroyPipelines();
   void compileShader(Resources& resources, bool fromFile = true) override;
 
 
   // Register command line parameters
   void registerParameters(nvutils::ParameterRegistry* paramReg);
 
+  // Samples per pixel of a complete render (maxFrames iterations), used to size the QOLDS net
+  uint64_t getSampleBudget(const Resources& resources) const;
+
+  // Dimensions of a path sample of maxDepth bounces (path_sampler.h.slang), used to size the QOLDS matrices
+  int getSampleDimensions() const;
+
+  // Next-event estimation samples the emissive triangles: their power then counts in the light selection
+  bool isEmissiveLightsEnabled() const { return m_emissiveLights; }
+
   VkDevice                        m_device{};  // Vulkan device
   VkPipelineLayout                m_pipelineLayout{};
-  VkPipeline                      m_rtxPipeline{};  // Ray tracing pipeline
-  VkPipeline                      m_rqPipeline{};   // Ray tracing pipeline
-  shaderio::PathtracePushConstant m_pushConst{};    // Information sent to the shader
+  VkPipeline                      m_rtxPipeline{};           // Ray tracing pipeline
+  VkPipeline                      m_rqPipeline{};            // Ray tracing pipeline
+  VkPipeline                      m_persistentPipeline{};    // Ray query pipeline, persistent threads
+  VkPipeline                      m_splitResolvePipeline{};  // Sum of the sample split (splitResolveMain)
+  shaderio::PathtracePushConstant m_pushConst{};             // Information sent to the shader
   float                           m_sceneRadius{1.0f};
   bool                            m_autoFocus{true};  // Enable auto-focus
   VkShaderModule                  m_shaderModule{};   // Shader module for RTX
@@ -92,14 +115,159 @@ public:
   // The default rendering technique
   RenderTechnique m_renderTechnique{RenderTechnique::RayTracing};
 
-  // Adaptive sampling for performance optimization
+  // Wavefront path tracing: one compute pipeline per kernel, queues sized for the render
+  enum WavefrontKernel
+  {
+    eWfGenerate,
+    eWfPrepare,
+    eWfExtend,
+    eWfSort,
+    eWfShade,
+    eWfConnect,
+    eWfAccumulate,
+    eWfKernelCount
+  };
+  void bindComputeDescriptorSets(VkCommandBuffer cmd, Resources& resources) const;
+  void renderWavefront(VkCommandBuffer cmd, Resources& resources, const VkExtent2D& size);
+  void createWavefrontBuffers(Resources& resources, uint32_t numPaths, uint32_t numKeys);
+  void destroyWavefrontBuffers(Resources& resources);
+
+  std::array<VkPipeline, eWfKernelCount> m_wfPipelines{};  // Pipelines of the wavefront kernels
+  nvvk::Buffer m_wfQueues;    // Path state, ray, hit and shadow queues (structures of arrays)
+  nvvk::Buffer m_wfHeader;    // shaderio::WavefrontQueues: addresses of the arrays in m_wfQueues
+  nvvk::Buffer m_wfCounters;  // Queue counters, indirect dispatch arguments and material counts
+  uint32_t     m_wfNumPaths{0};
+  uint32_t     m_wfNumKeys{0};
+
+  // Persistent threads and lane statistics (ePathtraceCounters, cleared every frame)
+  void readLaneStats();
+  void logPerformance() const;
+
+  static constexpr uint32_t LANE_STATS_LATENCY = 4;  // Frames before the statistics of a frame are read back
+  int          m_persistentGroups{1024};  // Workgroups of the persistent grid, enough to fill the GPU
+  bool         m_laneStats{false};        // Count the active lanes at every bounce (specialization constant)
+  nvvk::Buffer m_pathtraceCounters;       // shaderio PATHTRACE_* counters
+  nvvk::Buffer m_laneStatsReadback;       // Counters of the last LANE_STATS_LATENCY frames, host visible
+  uint32_t     m_laneStatsFrame{0};       // Frames recorded with lane or light statistics
+  nvsamples::RollingAverage<float, 100> m_laneOccupancyRollingAvg;  // Active lanes over wave lanes at every bounce
+
+  // Light selection learned from the contribution of every technique of sampleLights() over the first
+  // LIGHT_STATS_FRAMES frames of a render (PATHTRACE_LIGHT_STATS), read back with the lane statistics
+  void updateLightSelect(Resources& resources);
+
+  bool     m_adaptiveLightSelect{true};
+  bool     m_lightStatsActive{false};  // The calls of this frame record the light statistics
+  uint32_t m_lightStatsRender{0};      // Renders started, the statistics of an older one are dropped
+  std::array<uint32_t, LANE_STATS_LATENCY>           m_lightStatsSlots{};  // Render of the statistics of every readback slot, 0: none
+  std::array<double, shaderio::eLightTechniqueCount> m_lightStatsSums{};   // Contribution of every technique in this render
+
+  // Adaptive sampling for performance optimization: a model of the GPU time of a frame,
+  // cost x samples per pixel x megapixels, gives the sample count that fits the frame budget
   void                       updateAdaptiveSampling(Resources& resources);
+  void                       measureSampleCost(Resources& resources);
+  std::string                getSampleCostKey(const Resources& resources) const;
   nvutils::ProfilerTimeline* m_profilerTimeline{nullptr};
   bool                       m_adaptiveSampling{true};
   int                        m_totalSamplesAccumulated{0};  // Track total samples separately
 
-  // QOLDS sampling method 
-  bool m_useQOLDS{false};  // Toggle between default sampler and QOLDS
+  std::unordered_map<std::string, double> m_sampleCostMs;  // GPU ms per sample per megapixel, per scene and technique
+
+  // GPU time of every call, from its first to its last command (ReSTIR, path tracing, sample split
+  // resolve, adaptive tiles), two timestamps per slot read back LANE_STATS_LATENCY calls later
+  VkQueryPool                            m_timestampPool{VK_NULL_HANDLE};
+  double                                 m_timestampPeriodNs{1.0};
+  std::array<double, LANE_STATS_LATENCY> m_callWork{};  // Megasamples of the call of every slot, 0: none
+  uint32_t                               m_callIndex{0};
+
+  // Time slicing: a frame is rendered in slices of rows that fit the frame budget, over several calls
+  uint32_t getSliceRows(const Resources& resources, const VkExtent2D& size) const;
+  bool     m_timeSlicing{true};
+  float    m_sliceBudgetMs{33.3f};  // GPU time of a slice when Auto SPP is off
+  uint32_t m_sliceCursor{0};        // First row of the next slice
+  int      m_frameNumSamples{1};    // Samples per pixel of all slices of the frame
+
+  // Sample split: threads sharing the samples of a pixel on small images (grid Z), their partial
+  // sums added up by splitResolveMain
+  uint32_t getSampleSplit(const VkExtent2D& size) const;
+
+  static constexpr uint64_t SAMPLE_SPLIT_THREADS = 1 << 19;  // Threads that fill the GPU
+  static constexpr uint32_t SAMPLE_SPLIT_MAX     = 64;
+  bool                      m_sampleSplit{true};
+  nvvk::Buffer              m_splitPartials;  // Partial sums of every split of every pixel
+  VkDeviceSize              m_splitPartialsSize{0};
+
+  // Light selection: light BVH (light_tree.h.slang), or the alias table over the power of the lights
+  bool m_lightTree{true};
+  bool m_emissiveLights{true};  // Next-event estimation of the emissive triangles (emissive_lights.h.slang)
+
+  // Per-pixel adaptive sampling: variance of every pixel, samples per tile (adaptive_sampling.h.slang)
+  void updateFrameState(VkCommandBuffer cmd, Resources& resources, const VkRect2D& slice, uint32_t sampleSplit);
+  void dispatchAdaptiveTiles(VkCommandBuffer cmd, Resources& resources, const VkExtent2D& size);
+  void createAdaptiveBuffers(Resources& resources, const VkExtent2D& size);
+  bool isAdaptivePixelsEnabled() const { return m_adaptivePixels && !isDlssEnabled(); }
+
+  bool         m_adaptivePixels{false};    // Spend the samples where the relative error is highest
+  float        m_noiseThreshold{0.02f};    // Relative error of the mean under which a pixel stops
+  int          m_adaptiveMinSamples{16};   // Samples before a pixel may stop
+  VkPipeline   m_adaptivePipeline{};       // adaptiveTilesMain
+  nvvk::Buffer m_frameState;               // shaderio::PathtraceFrameState, updated every frame
+  nvvk::Buffer m_adaptiveErrorSums;        // Tile error sums of the last two frames (eAdaptiveErrorSums)
+  nvvk::Buffer m_adaptiveStats;            // Pixel statistics, then the samples of every tile
+  VkExtent2D   m_adaptiveSize{0, 0};
+
+  // ReSTIR DI of the primary hits (restir_di.h.slang): the reservoirs of every pixel are resampled at the
+  // start of a frame, before the path tracer reads them. Not with the wavefront kernels.
+  void dispatchRestir(VkCommandBuffer cmd, Resources& resources, const VkExtent2D& size);
+  void createRestirBuffers(Resources& resources, const VkExtent2D& size);
+  bool isRestirEnabled() const { return m_restir && m_renderTechnique != RenderTechnique::Wavefront; }
+
+  bool         m_restir{false};
+  int          m_restirCandidates{8};         // Light samples streamed into the reservoir of a pixel
+  bool         m_restirTemporal{true};        // Reuse the reservoir of the previous frame
+  int          m_restirSpatialSamples{4};     // Neighbors reused
+  float        m_restirSpatialRadius{16.0f};  // Pixels around the pixel where the neighbors are picked
+  VkPipeline   m_restirCandidatesPipeline{};  // restirCandidatesMain
+  VkPipeline   m_restirSpatialPipeline{};     // restirSpatialMain
+  nvvk::Buffer m_restirBuffer;                // Two slices of reservoirs, then two slices of surfaces
+  VkExtent2D   m_restirSize{0, 0};            // Pixels of a slice of m_restirBuffer
+  VkExtent2D   m_restirImageSize{0, 0};       // Render size of the reservoirs of the previous frame
+  uint32_t     m_restirFrame{0};
+  bool         m_restirHistoryValid{false};   // The reservoirs of the previous frame can be reused
+
+  // Path guiding (path_guiding.h.slang): the SD-tree learns from the radiance recorded by some paths,
+  // in iterations of doubling length (1, 2, 4... frames), and is refined on the host between them.
+  // Not with the wavefront kernels.
+  void updateGuiding(VkCommandBuffer cmd, Resources& resources);
+  bool isGuidingEnabled() const { return m_guiding && m_renderTechnique != RenderTechnique::Wavefront; }
+
+  static constexpr VkDeviceSize GUIDING_RECORDS_OFFSET = 16;  // Bytes of the record count, before the records
+  bool               m_guiding{false};
+  bool               m_guidingActive{false};  // The trees belong to the current render
+  GuidingTreeBuilder m_guidingBuilder;
+  nvvk::Buffer       m_guidingRecords;  // Record count, then the records of the iteration, host visible
+  nvvk::Buffer       m_guidingTree;     // Spatial nodes, then the directional nodes
+  VkDeviceSize       m_guidingTreeSize{0};
+  VkDeviceSize       m_guidingDirectionalOffset{0};
+  int                m_guidingIteration{0};
+  int                m_guidingIterationEnd{1};  // frameCount starting the next iteration
+
+  // Sampling method
+  shaderio::SamplerType m_samplerType{shaderio::SamplerType::eSamplerPcg};  // PCG, QOLDS or Sobol'-Owen (specialization constant)
+  shaderio::QoldsMode   m_qoldsMode{shaderio::QoldsMode::eQoldsAnalytic};   // Analytic or precomputed point table
+  bool                  m_qoldsPerPixel{true};                              // Decorrelate the sequence between pixels
+
+  static const char* getSamplerName(shaderio::SamplerType type)
+  {
+    switch(type)
+    {
+      case shaderio::SamplerType::eSamplerQolds:
+        return "QOLDS";
+      case shaderio::SamplerType::eSamplerSobolOwen:
+        return "Sobol'-Owen";
+      default:
+        return "PCG";
+    }
+  }
 
   bool m_useFastMSX{true};  // Toggle for fast multi-sample anti-aliasing
 
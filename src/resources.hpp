@@ -61,6 +61,8 @@ enum DirtyFlags
   eRtxScene,          // When the RTX acceleration structures need to be updated
   eHdrEnv,            // When the HDR environment needs to be updated
   eNodeVisibility,    // When the node visibility has changed
+  eQoldsTable,        // When the QOLDS point table needs to be rebuilt (format changed)
+  eQoldsSequence,     // When the sample budget or max depth changed and the QOLDS net may need more digits or dimensions
 
   eNumDirtyFlags  // Keep last - Number of dirty flags
 };
@@ -117,8 +119,30 @@ struct Resources
   shaderio::SkyPhysicalParameters skyParams{};   // Sky parameters
 
   // QOLDS sampling buffers
-  nvvk::Buffer bQoldsMatrices;  // QOLDS generator matrices
-  nvvk::Buffer bQoldsSeeds;     // QOLDS Owen scrambling seeds
+  nvvk::Buffer bQoldsMatrices;      // QOLDS generator matrices
+  nvvk::Buffer bQoldsSeeds;         // QOLDS Owen scrambling seeds
+  nvvk::Buffer bQoldsTable;         // QOLDS precomputed point table
+  nvvk::Buffer bQoldsScrambleTree;  // QOLDS precomputed Owen scramble tree levels
+  int          qoldsDimensions{0};  // Number of dimensions in the QOLDS buffers
+  int          qoldsDigits{0};      // Base-3 digits m of the QOLDS buffers (3^m points)
+
+  // Sobol'-Owen sampling buffers
+  nvvk::Buffer bSobolMatrices;  // Sobol' direction numbers
+  uint32_t     sobolSeed{0};    // Sobol' scrambling seed of the render
+
+  // Light selection
+  nvvk::Buffer bLightAlias;           // Alias table over the power of the lights
+  double       lightPower{0.0};       // Total power of the lights, against the power of the environment
+  nvvk::Buffer bLightTree;            // Light BVH over the point and spot lights, then the directional lights
+  int          lightTreeNodes{0};     // Nodes of the light BVH
+  int          lightTreeInfinite{0};  // Directional lights after the light BVH
+  nvvk::Buffer bEmissiveTriangles;    // Emissive triangles with their alias table
+  nvvk::Buffer bEmissiveNodes;        // First emissive triangle of every render node
+  int          emissiveTriangles{0};  // Emissive triangles of the next-event estimation
+  double       emissivePower{0.0};    // Total power of the emissive triangles
+  float        lightSelectLearned{-1.0f};     // Light selection probabilities learned by the path tracer, -1: from the power
+  float        emissiveSelectLearned{-1.0f};
+
   nvshaders::Tonemapper           tonemapper{};  // Tonemapper
   shaderio::TonemapperData        tonemapperData{
              .autoExposure = 1,
@@ -132,8 +156,9 @@ struct Resources
   VkDescriptorPool                        descriptorPool{};
 
 
-  int frameCount{0};
-  int selectedObject{-1};  // Selected object in the scene
+  int  frameCount{0};
+  bool framePending{false};  // The path tracer has rendered part of the frame (time slicing): hold the frame counter
+  int  selectedObject{-1};   // Selected object in the scene
 
   Settings settings;
 
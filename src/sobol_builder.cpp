@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "sobol_builder.hpp"
+#include <iostream>
+#include <random>
+
+namespace {
+// Same hash as qolds_hash() / sobol_hash() in the shaders
+uint32_t hash(uint32_t x)
+{
+  x ^= x >> 16u;
+  x *= 0x21f0aaadu;
+  x ^= x >> 15u;
+  x *= 0xd35a2d97u;
+  x ^= x >> 15u;
+  return x;
+}
+
+uint32_t reverseBits(uint32_t x)
+{
+  x = ((x >> 1u) & 0x55555555u) | ((x & 0x55555555u) << 1u);
+  x = ((x >> 2u) & 0x33333333u) | ((x & 0x33333333u) << 2u);
+  x = ((x >> 4u) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4u);
+  x = ((x >> 8u) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8u);
+  return (x >> 16u) | (x << 16u);
+}
+
+// Primitive polynomials and initial direction numbers of dimensions 2 .. 4 (new-joe-kuo-6.21201),
+// dimension 1 is the van der Corput sequence
+struct JoeKuoRow
+{
+  uint32_t s;     // Polynomial degree
+  uint32_t a;     // Polynomial coefficients, without the leading and constant terms
+  uint32_t m[3];  // Initial direction numbers m_1 .. m_s
+};
+constexpr JoeKuoRow kJoeKuo[SOBOL_MAX_DIMENSIONS - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Direction numbers V_i = m_i / 2^i, as 32-bit fractions
+//
+void SobolBuilder::buildMatrices()
+{
+  m_dimensions = SOBOL_MAX_DIMENSIONS;
+  m_directions.assign(size_t(SOBOL_MAX_DIMENSIONS) * SOBOL_BITS, 0u);
+
+  for(int bit = 0; bit < SOBOL_BITS; bit++)
+  {
+    m_directions[bit] = 1u << (31 - bit);
+  }
+
+  for(int d = 1; d < SOBOL_MAX_DIMENSIONS; d++)
+  {
+    const JoeKuoRow& row = kJoeKuo[d - 1];
+    uint32_t*        v   = &m_directions[size_t(d) * SOBOL_BITS];
+    for(uint32_t i = 0; i < uint32_t(SOBOL_BITS); i++)
+    {
+      if(i < row.s)
+      {
+        v[i] = row.m[i] << (31u - i);
+        continue;
+      }
+
+      // Recurrence of the primitive polynomial
+      v[i] = v[i - row.s] ^ (v[i - row.s] >> row.s);
+      for(uint32_t k = 1; k < row.s; k++)
+      {
+        v[i] ^= ((row.a >> (row.s - 1u - k)) & 1u) * v[i - k];
+      }
+    }
+  }
+
+  std::cout << "[Sobol] Built " << m_dimensions << " dimensions of " << SOBOL_BITS << " direction numbers" << std::endl;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Scrambling seed of the render
+//
+void SobolBuilder::generateScrambleSeed(uint32_t masterSeed)
+{
+  if(masterSeed == 0)
+  {
+    std::random_device hwseed;
+    masterSeed = hwseed();
+  }
+  m_seed = hash(masterSeed);
+}
+
+uint32_t SobolBuilder::pixelSeed(uint32_t x, uint32_t y) const
+{
+  return hashCombine(m_seed, (x & 0xFFFFu) | (y << 16u));
+}
+
+//--------------------------------------------------------------------------------------------------
+// CPU reference of sobol_owen_sample()
+//
+float SobolBuilder::samplePoint(uint32_t index, int dimension, uint32_t pixelSeed) const
+{
+  // Group of dimensions: its own shuffle of the index, so that the groups are independent
+  const uint32_t group     = uint32_t(dimension) / uint32_t(SOBOL_MAX_DIMENSIONS);
+  const uint32_t slot      = uint32_t(dimension) - group * uint32_t(SOBOL_MAX_DIMENSIONS);
+  const uint32_t groupSeed = hashCombine(pixelSeed, group);
+  const uint32_t shuffled  = nestedUniformScramble(index, groupSeed);
+
+  const uint32_t x = nestedUniformScramble(sobolBits(shuffled, int(slot)), hashCombine(groupSeed, slot + 1u));
+  return float(x >> 8u) * (1.0f / 16777216.0f);
+}
+
+uint32_t SobolBuilder::sobolBits(uint32_t index, int dimension) const
+{
+  const uint32_t* v = &m_directions[size_t(dimension) * SOBOL_BITS];
+  uint32_t        x = 0;
+  for(int bit = 0; index != 0u; bit++, index >>= 1u)
+  {
+    if(index & 1u)
+      x ^= v[bit];
+  }
+  return x;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Laine-Karras permutation on the reversed bits: every bit is flipped by a hash of the bits above it,
+// which is Owen scrambling of the binary digits
+//
+uint32_t SobolBuilder::nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+  x = reverseBits(x);
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return reverseBits(x);
+}
+
+uint32_t SobolBuilder::hashCombine(uint32_t seed, uint32_t value)
+{
+  return seed ^ (hash(value) + 0x9e3779b9u + (seed << 6u) + (seed >> 2u));
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+// Constants
+//
+constexpr int SOBOL_BITS           = 32;  // Direction numbers per dimension, one per bit of the index
+constexpr int SOBOL_MAX_DIMENSIONS = 4;   // Sobol' dimensions, SOBOL_GROUP_DIMENSIONS in shaderio.h
+
+//--------------------------------------------------------------------------------------------------
+// SobolBuilder: Host-side generator for the base-2 Sobol' sampler with hash-based Owen scrambling
+//
+// Burley's "Practical Hash-based Owen Scrambling" (JCGT 2020): the path dimensions are taken in
+// groups of SOBOL_MAX_DIMENSIONS, every group reads the first Sobol' dimensions with an index
+// shuffled by its own seed (padding), and every value is Owen-scrambled with a Laine-Karras hash.
+// Evaluating a point is only XORs of direction numbers, two bit reversals and a few multiplies.
+// sobol_sampling.h.slang is the GPU side; samplePoint() is its bit-exact CPU reference.
+//
+class SobolBuilder
+{
+public:
+  SobolBuilder()  = default;
+  ~SobolBuilder() = default;
+
+  // Build the direction numbers of the SOBOL_MAX_DIMENSIONS dimensions of a group (Joe-Kuo new-joe-kuo-6.21201)
+  void buildMatrices();
+
+  // Random seed of the scrambling, shared by every pixel and combined with the pixel's seed
+  // masterSeed: seed for random number generator (0 = use random device)
+  void generateScrambleSeed(uint32_t masterSeed = 0);
+
+  // Scrambling seed of a pixel, sobol_pixel_seed() in the shader
+  uint32_t pixelSeed(uint32_t x, uint32_t y) const;
+
+  // CPU reference of sobol_owen_sample(): any dimension, past getDimensions() in padded groups
+  // pixelSeed: pixelSeed() of the pixel, or getScrambleSeed() for the sequence shared by all pixels
+  float samplePoint(uint32_t index, int dimension, uint32_t pixelSeed) const;
+
+  // Get the direction numbers for GPU upload: [D][SOBOL_BITS], number b is XORed in for bit b of the index
+  const std::vector<uint32_t>& getMatrixData() const { return m_directions; }
+
+  // Get the scrambling seed of the render
+  uint32_t getScrambleSeed() const { return m_seed; }
+
+  // Get the number of dimensions
+  int getDimensions() const { return m_dimensions; }
+
+  //--------------------------------------------------------------------------------------------------
+  // Hash-based Owen scrambling, identical to the shader functions
+  //
+  // Owen scrambling of the bits of x, most significant first (reverse, Laine-Karras, reverse)
+  static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed);
+
+  // Seed of a sub-stream (a dimension group, a dimension)
+  static uint32_t hashCombine(uint32_t seed, uint32_t value);
+
+private:
+  // Unscrambled Sobol' bits of an index for a dimension of the group
+  uint32_t sobolBits(uint32_t index, int dimension) const;
+
+  int                   m_dimensions{0};
+  uint32_t              m_seed{0};
+  std::vector<uint32_t> m_directions;  // [D][SOBOL_BITS]
+};
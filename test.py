@@ -11,9 +11,29 @@ logging.basicConfig(
 logger = logging.getLogger(__name__)
 
 # Predefined executables and their arguments
-EXECUTABLES_WITH_ARGS = [
-    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "env3.hdr", "--envSystem", "1", "--frames", "10"]),
+HEADLESS_ARGS = ["--headless", "shader_ball.gltf", "env3.hdr", "--envSystem", "1", "--frames", "10"]
+
+# Smoke runs of every path tracer technique and sampler specialization
+PATHTRACER_VARIANTS = [
+    [],
+    ["--ptTechnique", "0"],  # RayQuery megakernel
+    ["--ptTechnique", "1"],  # RayTracing pipeline
+    ["--ptTechnique", "2"],  # Wavefront
+    ["--ptTechnique", "3"],  # Persistent threads
+    ["--ptTechnique", "0", "--ptSampleSplit", "1"],
+    ["--ptRestir", "1"],
+    ["--ptGuiding", "1"],
+    ["--ptAdaptivePixels", "1"],
+    ["--ptSampler", "0"],  # PCG
+    ["--ptSampler", "1"],  # QOLDS analytic
+    ["--ptSampler", "1", "--ptQoldsMode", "1"],  # QOLDS float table
+    ["--ptSampler", "1", "--ptQoldsMode", "2"],  # QOLDS unorm16 table
+    ["--ptSampler", "2"],  # Sobol'-Owen
+    ["--ptLaneStats", "1"],
+]
 
+EXECUTABLES_WITH_ARGS = [
+    ("vk_gltf_renderer", HEADLESS_ARGS + variant) for variant in PATHTRACER_VARIANTS
 ]
 
 class ReturnCode(Enum):
@@ -69,7 +89,7 @@ def test_executable(test_dir, executable, args):
         testing_time = extract_testing_time(log_file)
         
         return (
-            executable,
+            " ".join([executable] + args[len(HEADLESS_ARGS):]),
             ReturnCode.SUCCESS.value if return_code == 0 else ReturnCode.TEST_ERROR.value,
             testing_time
         )
@@ -101,12 +121,12 @@ def print_report(results):
     """Print a formatted report of test results."""
     logger.info("\nTest Results:")
     logger.info("-" * 80)
-    logger.info("{:<35} | {:<12} | {:<8}".format("Executable", "Status", "Time"))
+    logger.info("{:<50} | {:<12} | {:<8}".format("Executable", "Status", "Time"))
     logger.info("-" * 80)
     
     for executable, return_code, testing_time in results:
         status = "SUCCESS" if return_code == ReturnCode.SUCCESS.value else "FAILED"
-        logger.info("{:<35} | {:<12} | {:<8}".format(
+        logger.info("{:<50} | {:<12} | {:<8}".format(
             executable, status, testing_time
         ))
     logger.info("-" * 80)
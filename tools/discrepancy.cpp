@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "discrepancy.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+constexpr uint32_t kTile = 512;  // Points of a tile: the two product arrays stay in L1
+
+// Kernels of one dimension, on points [begin, end) of the tile
+inline void kernelScalar(double xi, double ai, const double* xj, const double* aj, double* star, double* centered,
+                         uint32_t begin, uint32_t end)
+{
+  for(uint32_t j = begin; j < end; j++)
+  {
+    star[j] *= 1.0 - std::max(xi, xj[j]);
+    centered[j] *= 1.0 + 0.5 * (ai + aj[j] - std::abs(xi - xj[j]));
+  }
+}
+
+inline void kernel(double xi, double ai, const double* xj, const double* aj, double* star, double* centered, uint32_t count)
+{
+#if defined(__AVX2__)
+  const __m256d one      = _mm256_set1_pd(1.0);
+  const __m256d half     = _mm256_set1_pd(0.5);
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  const __m256d xi4      = _mm256_set1_pd(xi);
+  const __m256d ai4      = _mm256_set1_pd(ai);
+
+  uint32_t j = 0;
+  for(; j + 4 <= count; j += 4)
+  {
+    const __m256d x = _mm256_loadu_pd(xj + j);
+    const __m256d a = _mm256_loadu_pd(aj + j);
+
+    __m256d s = _mm256_load_pd(star + j);
+    s         = _mm256_mul_pd(s, _mm256_sub_pd(one, _mm256_max_pd(xi4, x)));
+    _mm256_store_pd(star + j, s);
+
+    const __m256d dist = _mm256_andnot_pd(signMask, _mm256_sub_pd(xi4, x));
+    __m256d       c    = _mm256_load_pd(centered + j);
+    c = _mm256_mul_pd(c, _mm256_add_pd(one, _mm256_mul_pd(half, _mm256_sub_pd(_mm256_add_pd(ai4, a), dist))));
+    _mm256_store_pd(centered + j, c);
+  }
+  kernelScalar(xi, ai, xj, aj, star, centered, j, count);
+#else
+  kernelScalar(xi, ai, xj, aj, star, centered, 0, count);
+#endif
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Pairs (i, j > i) of a row, tile by tile: each dimension multiplies the kernels of the whole tile
+//
+void DiscrepancyEvaluator::pairRow(uint32_t i, int dimensions, double& star, double& centered) const
+{
+  alignas(32) double tileStar[kTile];
+  alignas(32) double tileCentered[kTile];
+
+  star     = 0.0;
+  centered = 0.0;
+  for(uint32_t begin = i + 1; begin < m_numPoints; begin += kTile)
+  {
+    const uint32_t count = std::min(kTile, m_numPoints - begin);
+    std::fill(tileStar, tileStar + count, 1.0);
+    std::fill(tileCentered, tileCentered + count, 1.0);
+
+    for(int d = 0; d < dimensions; d++)
+    {
+      const size_t row = size_t(d) * m_numPoints;
+      kernel(m_coords[row + i], m_centered[row + i], &m_coords[row + begin], &m_centered[row + begin], tileStar,
+             tileCentered, count);
+    }
+
+    for(uint32_t j = 0; j < count; j++)
+    {
+      star += tileStar[j];
+      centered += tileCentered[j];
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Warnock (L2-star) and Hickernell (centered L2) closed forms, sharing the pass over the pairs
+//
+DiscrepancyEvaluator::Discrepancies DiscrepancyEvaluator::evaluate(int dimensions) const
+{
+  if(dimensions < 0)
+    dimensions = m_dimensions;
+
+  const uint32_t n = m_numPoints;
+
+  // One row per item; rows get shorter with i, the batches are small so the threads stay balanced
+  std::vector<double> rowStar(n), rowCentered(n);
+  nvutils::parallel_batches<16>(uint64_t(n), [&](uint64_t i) { pairRow(uint32_t(i), dimensions, rowStar[i], rowCentered[i]); });
+
+  double pairsStar = 0.0, pairsCentered = 0.0;
+  double diagStar = 0.0, diagCentered = 0.0;
+  double singleStar = 0.0, singleCentered = 0.0;
+  for(uint32_t i = 0; i < n; i++)
+  {
+    pairsStar += rowStar[i];
+    pairsCentered += rowCentered[i];
+
+    double ds = 1.0, dc = 1.0, ss = 1.0, sc = 1.0;
+    for(int d = 0; d < dimensions; d++)
+    {
+      const double x = m_coords[size_t(d) * n + i];
+      const double a = m_centered[size_t(d) * n + i];
+      ds *= 1.0 - x;
+      dc *= 1.0 + a;
+      ss *= 1.0 - x * x;
+      sc *= 1.0 + 0.5 * a - 0.5 * a * a;
+    }
+    diagStar += ds;
+    diagCentered += dc;
+    singleStar += ss;
+    singleCentered += sc;
+  }
+
+  const double invN  = 1.0 / double(n);
+  const double s     = double(dimensions);
+  const double star2 = std::pow(3.0, -s) - std::pow(2.0, 1.0 - s) * invN * singleStar + invN * invN * (diagStar + 2.0 * pairsStar);
+  const double centered2 =
+      std::pow(13.0 / 12.0, s) - 2.0 * invN * singleCentered + invN * invN * (diagCentered + 2.0 * pairsCentered);
+
+  return {std::sqrt(std::max(star2, 0.0)), std::sqrt(std::max(centered2, 0.0))};
+}
+
+//--------------------------------------------------------------------------------------------------
+// 2D L2-star discrepancy in O(N log N)
+// Sweeping the points by increasing x, every earlier point k has max(x_k, x_i) = x_i, and
+// max(y_k, y_i) is y_i for the earlier points below y_i and y_k above it: the pair sum of point i
+// is (1 - x_i) * ((1 - y_i) * count(y_k <= y_i) + sum(1 - y_k, y_k > y_i)), two Fenwick queries.
+//
+double DiscrepancyEvaluator::l2StarProjection(int d0, int d1) const
+{
+  const uint32_t  n     = m_numPoints;
+  const uint32_t* order = &m_order[size_t(d0) * n];
+  const uint32_t* rank  = &m_rank[size_t(d1) * n];
+  const double*   xs    = &m_coords[size_t(d0) * n];
+  const double*   ys    = &m_coords[size_t(d1) * n];
+
+  std::vector<uint32_t> treeCount(n + 1, 0u);
+  std::vector<double>   treeSum(n + 1, 0.0);
+
+  double pairs = 0.0, diag = 0.0, single = 0.0, insertedSum = 0.0;
+  for(uint32_t p = 0; p < n; p++)
+  {
+    const uint32_t i = order[p];
+    const double   x = xs[i];
+    const double   y = ys[i];
+
+    // Earlier points at or below y_i (rank is a unique position, ties fall on either side with the same value)
+    uint32_t countBelow = 0;
+    double   sumBelow   = 0.0;
+    for(uint32_t r = rank[i] + 1; r > 0; r -= r & (~r + 1u))
+    {
+      countBelow += treeCount[r];
+      sumBelow += treeSum[r];
+    }
+    pairs += (1.0 - x) * ((1.0 - y) * double(countBelow) + (insertedSum - sumBelow));
+
+    for(uint32_t r = rank[i] + 1; r <= n; r += r & (~r + 1u))
+    {
+      treeCount[r]++;
+      treeSum[r] += 1.0 - y;
+    }
+    insertedSum += 1.0 - y;
+
+    diag += (1.0 - x) * (1.0 - y);
+    single += (1.0 - x * x) * (1.0 - y * y);
+  }
+
+  const double invN = 1.0 / double(n);
+  const double d2   = 1.0 / 9.0 - 0.5 * invN * single + invN * invN * (diag + 2.0 * pairs);
+  return std::sqrt(std::max(d2, 0.0));
+}
+
+DiscrepancyEvaluator::ProjectionStats DiscrepancyEvaluator::projections2D(int dimensions, bool consecutiveOnly) const
+{
+  if(dimensions < 0)
+    dimensions = m_dimensions;
+
+  std::vector<std::pair<int, int>> pairs;
+  for(int d0 = 0; d0 < dimensions; d0++)
+    for(int d1 = d0 + 1; d1 < (consecutiveOnly ? std::min(d0 + 2, dimensions) : dimensions); d1++)
+      pairs.emplace_back(d0, d1);
+
+  std::vector<double> ratios(pairs.size());
+  const double        reference = randomL2Star(m_numPoints, 2);
+  nvutils::parallel_batches<1>(uint64_t(pairs.size()), [&](uint64_t p) {
+    ratios[p] = l2StarProjection(pairs[p].first, pairs[p].second) / reference;
+  });
+
+  ProjectionStats stats;
+  stats.numPairs = int(pairs.size());
+  for(size_t p = 0; p < pairs.size(); p++)
+  {
+    stats.meanRatio += ratios[p];
+    if(ratios[p] > stats.worstRatio)
+    {
+      stats.worstRatio   = ratios[p];
+      stats.worstPair[0] = pairs[p].first;
+      stats.worstPair[1] = pairs[p].second;
+    }
+  }
+  if(!pairs.empty())
+    stats.meanRatio /= double(pairs.size());
+  return stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Expectations for N independent uniform points: (E K(x, x) - E K(x, y)) / N for both kernels
+//
+double DiscrepancyEvaluator::randomL2Star(uint32_t numPoints, int dimensions)
+{
+  const double s = double(dimensions);
+  return std::sqrt((std::pow(2.0, -s) - std::pow(3.0, -s)) / double(numPoints));
+}
+
+double DiscrepancyEvaluator::randomCenteredL2(uint32_t numPoints, int dimensions)
+{
+  const double s = double(dimensions);
+  return std::sqrt((std::pow(1.25, s) - std::pow(13.0 / 12.0, s)) / double(numPoints));
+}
+
+void DiscrepancyEvaluator::buildOrders()
+{
+  const uint32_t n = m_numPoints;
+  m_order.resize(size_t(m_dimensions) * n);
+  m_rank.resize(m_order.size());
+
+  nvutils::parallel_batches<1>(uint64_t(m_dimensions), [&](uint64_t d) {
+    uint32_t*     order = &m_order[d * n];
+    uint32_t*     rank  = &m_rank[d * n];
+    const double* x     = &m_coords[d * n];
+    std::iota(order, order + n, 0u);
+    std::stable_sort(order, order + n, [&](uint32_t a, uint32_t b) { return x[a] < x[b]; });
+    for(uint32_t p = 0; p < n; p++)
+      rank[order[p]] = p;
+  });
+}
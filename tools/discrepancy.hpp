@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <nvutils/parallel_work.hpp>
+
+//--------------------------------------------------------------------------------------------------
+// DiscrepancyEvaluator: quality measures of a point set, for any sampler
+//
+// - L2-star discrepancy (Warnock's formula): boxes anchored at the origin
+// - Centered L2 discrepancy (Hickernell): boxes anchored at the nearest corner of the cube, i.e.
+//   the quadrant discrepancy averaged over the 2^s corners, so it does not favor the origin
+// - L2-star discrepancy of 2D projections, in O(N log N) per pair (sweep in x, Fenwick tree in y)
+//
+// The full-dimensional measures sum a kernel over all N^2 pairs of points: the pairs are spread over
+// threads by rows, and every row is evaluated over tiles of the other points with the coordinates
+// stored per dimension, so the inner loop is a SIMD loop over contiguous points (AVX2 when available).
+// All measures are also given for uniform random points (their expectation), so a sampler is judged
+// by the ratio: below 1 it is better than independent random numbers.
+//
+class DiscrepancyEvaluator
+{
+public:
+  // Discrepancies over all dimensions of a set
+  struct Discrepancies
+  {
+    double l2Star{0.0};
+    double centeredL2{0.0};
+  };
+
+  // Statistics of the 2D projections, as ratios to the expected random discrepancy
+  struct ProjectionStats
+  {
+    double meanRatio{0.0};   // Mean of D / D_random over the pairs
+    double worstRatio{0.0};  // Largest D / D_random
+    int    worstPair[2]{};   // Dimensions of the worst pair
+    int    numPairs{0};
+  };
+
+  // Points from any sampler: fn(index, dimension) -> value in [0, 1), evaluated in parallel over dimensions
+  template <typename SampleFn>
+  void setPoints(uint32_t numPoints, int dimensions, SampleFn&& fn);
+
+  // Discrepancies of the first `dimensions` dimensions (all if < 0), both kernels in one pass over the N^2 pairs
+  Discrepancies evaluate(int dimensions = -1) const;
+
+  // L2-star discrepancy of the 2D projection on dimensions d0 and d1
+  double l2StarProjection(int d0, int d1) const;
+
+  // All pairs of the first `dimensions` dimensions, or only consecutive ones
+  ProjectionStats projections2D(int dimensions = -1, bool consecutiveOnly = false) const;
+
+  // Expected discrepancies of N uniform random points in s dimensions
+  static double randomL2Star(uint32_t numPoints, int dimensions);
+  static double randomCenteredL2(uint32_t numPoints, int dimensions);
+
+  uint32_t getNumPoints() const { return m_numPoints; }
+  int      getDimensions() const { return m_dimensions; }
+
+private:
+  // Sums of the L2-star and centered kernels over the pairs (i, j > i) of row i
+  void pairRow(uint32_t i, int dimensions, double& star, double& centered) const;
+
+  // Sort of every dimension: order of the points and rank of every point
+  void buildOrders();
+
+  uint32_t              m_numPoints{0};
+  int                   m_dimensions{0};
+  std::vector<double>   m_coords;    // [D][N]
+  std::vector<double>   m_centered;  // [D][N] |x - 1/2|
+  std::vector<uint32_t> m_order;     // [D][N] points sorted by coordinate
+  std::vector<uint32_t> m_rank;      // [D][N] position of every point in its dimension's order
+};
+
+//--------------------------------------------------------------------------------------------------
+// Template implementation
+//
+template <typename SampleFn>
+void DiscrepancyEvaluator::setPoints(uint32_t numPoints, int dimensions, SampleFn&& fn)
+{
+  m_numPoints  = numPoints;
+  m_dimensions = dimensions;
+  m_coords.resize(size_t(dimensions) * numPoints);
+  m_centered.resize(m_coords.size());
+
+  nvutils::parallel_batches<1>(uint64_t(dimensions), [&](uint64_t d) {
+    double* x = &m_coords[d * numPoints];
+    double* a = &m_centered[d * numPoints];
+    for(uint32_t i = 0; i < numPoints; i++)
+    {
+      x[i] = double(fn(i, int(d)));
+      a[i] = (x[i] < 0.5) ? 0.5 - x[i] : x[i] - 0.5;
+    }
+  });
+
+  buildOrders();
+}
@@ -0,0 +1,95 @@
+import argparse
+import subprocess
+import logging
+import re
+from pathlib import Path
+
+# Set up logging
+logging.basicConfig(
+    level=logging.INFO, format="%(asctime)s - %(levelname)s - %(message)s"
+)
+logger = logging.getLogger(__name__)
+
+# Benchmark of the persistent-threads ray query technique against the one-thread-per-pixel dispatch.
+# Both run headless on the same scene with the same fixed sample count, with lane statistics on:
+# the renderer logs its throughput and the SIMD lane occupancy of the path tracing loop at the end.
+
+# Rendering techniques compared (ptTechnique)
+TECHNIQUES = [
+    ("Ray Query", 0),
+    ("Ray Query (Persistent)", 3),
+]
+
+PERFORMANCE_LINE = re.compile(
+    r"Path tracer performance: (?P<technique>.+?), (?P<mspp>[\d.]+) MSPP/s \([\d.]+ ns per sample\), "
+    r"lane occupancy (?P<occupancy>[\d.]+)%"
+)
+
+
+def run_benchmark(executable, technique, args):
+    """Run the renderer headless with one technique and return (MSPP/s, lane occupancy %), or None."""
+    commands = [
+        str(executable),
+        "--headless",
+        args.scene,
+        "--frames", str(args.frames),
+        "--maxFrames", str(args.frames + 1),
+        "--ptTechnique", str(technique),
+        "--ptSamples", str(args.samples),
+        "--ptMaxDepth", str(args.depth),
+        "--ptPersistentGroups", str(args.groups),
+        "--ptAdaptiveSampling", "0",
+        "--ptTimeSlicing", "0",
+        "--ptLaneStats", "1",
+    ]
+    logger.info(f"Running command: {' '.join(commands)}")
+    try:
+        result = subprocess.run(commands, check=True, text=True, capture_output=True)
+    except (subprocess.CalledProcessError, OSError) as e:
+        logger.error(f"Error occurred: {e}")
+        return None
+
+    match = None
+    for line in (result.stdout + result.stderr).splitlines():
+        match = PERFORMANCE_LINE.search(line) or match
+    if match is None:
+        logger.error("No performance line in the output of the renderer")
+        return None
+    return float(match["mspp"]), float(match["occupancy"])
+
+
+def print_report(results):
+    """Print the throughput and lane occupancy of every technique, relative to the first one."""
+    logger.info("\nPersistent threads benchmark:")
+    logger.info("-" * 80)
+    logger.info("{:<28} | {:>10} | {:>14} | {:>8}".format("Technique", "MSPP/s", "Lane occupancy", "Speedup"))
+    logger.info("-" * 80)
+    reference = results[0][1] if results and results[0][1] else None
+    for name, measure in results:
+        if measure is None:
+            logger.info("{:<28} | {:>10} | {:>14} | {:>8}".format(name, "N/A", "N/A", "N/A"))
+            continue
+        mspp, occupancy = measure
+        speedup = f"{mspp / reference[0]:.2f}x" if reference and reference[0] > 0 else "N/A"
+        logger.info("{:<28} | {:>10.2f} | {:>13.1f}% | {:>8}".format(name, mspp, occupancy, speedup))
+    logger.info("-" * 80)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare the persistent-threads path tracer with the per-pixel dispatch.")
+    parser.add_argument("--exe", default="_install/vk_gltf_renderer", help="Renderer executable")
+    parser.add_argument("--scene", default="shader_ball.gltf", help="Scene to render")
+    parser.add_argument("--frames", type=int, default=200, help="Frames rendered by every run")
+    parser.add_argument("--samples", type=int, default=4, help="Samples per pixel per frame")
+    parser.add_argument("--depth", type=int, default=5, help="Maximum path depth")
+    parser.add_argument("--groups", type=int, default=1024, help="Workgroups of the persistent grid")
+    args = parser.parse_args()
+
+    executable = Path(args.exe)
+    results = [(name, run_benchmark(executable, technique, args)) for name, technique in TECHNIQUES]
+    print_report(results)
+    return 0 if all(measure is not None for _, measure in results) else 1
+
+
+if __name__ == "__main__":
+    exit(main())
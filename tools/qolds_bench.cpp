@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    QOLDS CPU benchmark
+
+    Measures the per-sample cost of the QOLDS evaluation modes used by the
+    path tracer (see qolds_sampling.h.slang):
+    - Analytic: generator matrices + FCRNG Owen scrambling for every sample,
+                one trit per int (reference) and bit-sliced (PackedTrits, as the shader)
+    - Table:    one load from the precomputed scrambled point table
+    - Stream:   N consecutive points per dimension in Gray-code order, each
+                one column add away from the previous (sampleStream, not used
+                by the shader), against the same points built from scratch
+
+    The net check builds dimensions from scratch with the GF(3) polynomial
+    search (extendInitData): the first three must form a (0,m,3)-net for
+    every m, which is verified both with the rank criterion (netQuality) and
+    by counting the scrambled points in every elementary interval.
+
+    It also times the builder itself: the matrices (runtime and baked) and
+    rescramble(), the per-render-job scrambling that leaves the matrices alone
+    and must give the same seeds and trees as generateScrambleSeeds().
+
+    The Sobol'-Owen backend (SobolBuilder) is timed against the same
+    dimensions; its first two dimensions, and the first two of every padded
+    group, must form a scrambled (0,m,2)-net in base 2.
+
+    The packed arithmetic must be bit-exact with the per-digit reference, the
+    tables must match the analytic points, and the compile-time matrices
+    (qolds_matrices.hpp) must equal the ones built from the .dat file for every
+    m; any mismatch fails the run.
+
+    Usage: qolds_bench <initIrreducibleGF3.dat> [digits=5] [samples=1000000]
+
+    The GPU side of the comparison is reported by the renderer itself:
+    run headless with --ptSampler <0|1|2> --ptQoldsMode <0|1|2|3> and read the
+    "Path tracer performance" line (MSPP/s and ns per sample).
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "qolds_builder.hpp"
+#include "sobol_builder.hpp"
+
+namespace {
+
+// Prevents the compiler from discarding the benchmarked work
+volatile float g_sink = 0.0f;
+
+struct BenchResult
+{
+  double nsPerSample{0.0};
+  float  checksum{0.0f};
+};
+
+// Time `samples` evaluations spread over all dimensions
+template <typename SampleFn>
+BenchResult runBenchmark(int dimensions, uint32_t samples, SampleFn&& sampleFn)
+{
+  auto  start = std::chrono::high_resolution_clock::now();
+  float sum   = 0.0f;
+  for(uint32_t i = 0; i < samples; i++)
+  {
+    sum += sampleFn(i / uint32_t(dimensions), int(i % uint32_t(dimensions)));
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  g_sink = sum;
+  return {std::chrono::duration<double, std::nano>(end - start).count() / double(samples), sum};
+}
+
+// Equivalent of qolds_sample_table() for the float32 table
+float tableFloat(const uint32_t* table, uint32_t numPoints, uint32_t index, int dimension)
+{
+  uint32_t word = table[size_t(dimension) * numPoints + index % numPoints];
+  float    x;
+  std::memcpy(&x, &word, sizeof(float));
+  return x;
+}
+
+// Equivalent of qolds_sample_table() for the 16-bit unorm table
+float tableUnorm16(const uint32_t* table, uint32_t numPoints, uint32_t index, int dimension)
+{
+  const uint32_t i    = index % numPoints;
+  uint32_t       word = table[size_t(dimension) * ((numPoints + 1u) / 2u) + (i >> 1u)];
+  return float((word >> ((i & 1u) * 16u)) & 0xFFFFu) * (1.0f / 65536.0f);
+}
+
+// Check the PackedTrits operations digit by digit against plain mod-3 arithmetic
+bool checkPackedArithmetic()
+{
+  uint32_t state = 0x9e3779b9u;
+  auto     next  = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return state;
+  };
+
+  for(int test = 0; test < 100000; test++)
+  {
+    uint32_t x = next() % 43046721u;  // 3^16
+    uint32_t y = next() % 43046721u;
+    uint32_t d = next() % 3u;
+    uint32_t a = PackedTrits::fromUint(x);
+    uint32_t b = PackedTrits::fromUint(y);
+
+    uint32_t sum  = PackedTrits::add(a, b);
+    uint32_t diff = PackedTrits::sub(a, b);
+    uint32_t fma  = PackedTrits::fma(a, d, b);
+    for(uint32_t j = 0; j < QOLDS_PACKED_TRITS; j++)
+    {
+      uint32_t aj = PackedTrits::digit(a, j);
+      uint32_t bj = PackedTrits::digit(b, j);
+      if(PackedTrits::digit(sum, j) != (aj + bj) % 3u || PackedTrits::digit(diff, j) != (aj + 3u - bj) % 3u
+         || PackedTrits::digit(fma, j) != (aj + d * bj) % 3u)
+      {
+        std::printf("[QOLDS] Error: packed arithmetic mismatch (x=%u, y=%u, d=%u, digit %u)\n", x, y, d, j);
+        return false;
+      }
+    }
+    // Both planes set would be an invalid digit
+    if((sum & (sum >> 16u)) != 0u || (fma & (fma >> 16u)) != 0u)
+    {
+      std::printf("[QOLDS] Error: packed arithmetic produced an invalid digit (x=%u, y=%u)\n", x, y);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Number of points where the packed sampler differs from the per-digit reference
+int countPackedMismatches(const QOLDSBuilder& builder)
+{
+  int mismatches = 0;
+  for(int d = 0; d < builder.getDimensions(); d++)
+  {
+    // Two periods, so index digits above m are exercised too
+    for(uint32_t i = 0; i < 2u * uint32_t(builder.getMaxPoints()); i++)
+    {
+      float reference = builder.samplePoint(i, d);
+      float packed    = builder.samplePointPacked(i, d);
+      if(std::memcmp(&reference, &packed, sizeof(float)) != 0)
+        mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+// Largest difference between the table and the analytic points
+template <typename SampleFn>
+float maxTableError(const QOLDSBuilder& builder, SampleFn&& tableFn)
+{
+  float maxError = 0.0f;
+  for(int d = 0; d < builder.getDimensions(); d++)
+  {
+    for(int i = 0; i < builder.getMaxPoints(); i++)
+    {
+      maxError = std::max(maxError, std::abs(tableFn(uint32_t(i), d) - builder.samplePoint(uint32_t(i), d)));
+    }
+  }
+  return maxError;
+}
+
+// Stream of `count` points per dimension against the same points built from scratch
+bool benchStream(const QOLDSBuilder& builder, uint32_t count)
+{
+  const int          dimensions = builder.getDimensions();
+  std::vector<float> stream(count), scratch(count);
+
+  double   streamNs = 0.0, scratchNs = 0.0;
+  uint64_t streamAdds = 0, scratchAdds = 0;
+  int      mismatches = 0;
+  for(int d = 0; d < dimensions; d++)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    streamAdds += builder.sampleStream(0, count, d, 0, stream.data());
+    auto mid = std::chrono::high_resolution_clock::now();
+    for(uint32_t i = 0; i < count; i++)
+      scratch[i] = builder.samplePointPacked(builder.grayIndex(i), d);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    streamNs += std::chrono::duration<double, std::nano>(mid - start).count();
+    scratchNs += std::chrono::duration<double, std::nano>(end - mid).count();
+    for(uint32_t i = 0; i < count; i++)
+    {
+      if(std::memcmp(&stream[i], &scratch[i], sizeof(float)) != 0)
+        mismatches++;
+      // From scratch, a point adds one column per non-zero index digit
+      uint32_t g3 = PackedTrits::fromUint(builder.grayIndex(i) % uint32_t(builder.getMaxPoints()), QOLDS_SEQUENCE_LENGTH);
+      scratchAdds += uint32_t(std::popcount((g3 | (g3 >> 16u)) & 0xFFFFu));
+    }
+  }
+  g_sink = stream[count - 1] + scratch[count - 1];
+
+  const double numSamples = double(count) * double(dimensions);
+  std::printf("%-20s | %12.2f  (%.1fx, %.2f column adds/sample vs %.2f from scratch, %d mismatching points)\n",
+              "Stream (Gray)", streamNs / numSamples, scratchNs / streamNs, double(streamAdds) / numSamples,
+              double(scratchAdds) / numSamples, mismatches);
+  return mismatches == 0;
+}
+
+// Cost of the builder steps, and rescramble() against generateScrambleSeeds() for the same seed
+bool benchBuilder(const QOLDSBuilder& loaded, int dimensions, int digits)
+{
+  using Clock = std::chrono::high_resolution_clock;
+  auto microseconds = [](Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  };
+
+  QOLDSBuilder builder = loaded;
+  builder.buildMatrices(dimensions, digits);  // Warm-up
+  auto start = Clock::now();
+  builder.buildMatrices(dimensions, digits);
+  const double runtimeUs = microseconds(start);
+
+  QOLDSBuilder baked;
+  start = Clock::now();
+  baked.buildBakedMatrices(dimensions, digits);
+  const double bakedUs = microseconds(start);
+
+  builder.generateScrambleSeeds(1u);
+  const uint32_t numJobs = 1000;
+  start                  = Clock::now();
+  for(uint32_t job = 0; job < numJobs; job++)
+    builder.rescramble(job + 2u);
+  const double rescrambleUs = microseconds(start) / numJobs;
+
+  // The last job must match a fresh generation with its seed
+  baked.generateScrambleSeeds(numJobs + 1u);
+  const bool match = builder.getScrambleSeeds() == baked.getScrambleSeeds()
+                     && builder.getScrambleTreeData() == baked.getScrambleTreeData();
+
+  std::printf("\nQOLDS builder cost (%d dimensions, m=%d)\n", dimensions, digits);
+  std::printf("%-20s | %12.2f us\n", "buildMatrices", runtimeUs);
+  std::printf("%-20s | %12.2f us\n", "buildBakedMatrices", bakedUs);
+  std::printf("%-20s | %12.2f us  (%s generateScrambleSeeds)\n", "rescramble", rescrambleUs,
+              match ? "same as" : "DIFFERENT from");
+  return match;
+}
+
+// Number of scrambled points of the first `count` dimensions in every elementary interval with
+// split[i] digits fixed in dimension i: all equal to 3^t for a (t,m,s)-net
+bool countElementaryIntervals(const QOLDSBuilder& builder, int count, int digits, int t)
+{
+  uint32_t pow3[QOLDS_SEQUENCE_LENGTH + 1];
+  pow3[0] = 1u;
+  for(int i = 1; i <= QOLDS_SEQUENCE_LENGTH; i++)
+    pow3[i] = 3u * pow3[i - 1];
+
+  std::vector<uint32_t> cells(pow3[digits - t]);
+  int                   split[4] = {};
+  split[count - 1]               = digits - t;
+  for(;;)
+  {
+    std::fill(cells.begin(), cells.end(), 0u);
+    for(uint32_t i = 0; i < pow3[digits]; i++)
+    {
+      uint32_t cell = 0;
+      for(int d = 0; d < count; d++)
+      {
+        // First split[d] digits of the point (exact: the point is value / 3^m)
+        const uint32_t value = uint32_t(std::lround(double(builder.samplePoint(i, d)) * pow3[digits]));
+        cell                 = cell * pow3[split[d]] + value / pow3[digits - split[d]];
+      }
+      cells[cell]++;
+    }
+    if(std::any_of(cells.begin(), cells.end(), [&](uint32_t n) { return n != pow3[t]; }))
+      return false;
+
+    // Next split of the m - t digits
+    int i = count - 1;
+    while(i > 0 && split[i] == 0)
+      i--;
+    if(i == 0)
+      return true;
+    split[i - 1]++;
+    const int rest   = split[i] - 1;
+    split[i]         = 0;
+    split[count - 1] = rest;
+  }
+}
+
+// (0,m,s)-nets of the dimensions searched from scratch, and t-values of the searched 2D projections
+bool checkNets(const QOLDSBuilder& loaded)
+{
+  const int firstDims[3] = {0, 1, 2};
+  bool      success      = true;
+
+  auto generated = std::make_unique<QOLDSBuilder>();
+  generated->extendInitData(QOLDS_SEARCH_WINDOW, "");
+  generated->buildMatrices(QOLDS_SEARCH_WINDOW, QOLDS_SEQUENCE_LENGTH);
+  generated->generateScrambleSeeds(7u);
+  for(int m = 1; m <= QOLDS_SEQUENCE_LENGTH; m++)
+    success &= (generated->netQuality(firstDims, 3, m) == 0);
+  for(int m = 1; m <= 6; m++)
+  {
+    generated->buildMatrices(QOLDS_SEARCH_WINDOW, m);
+    success &= countElementaryIntervals(*generated, 3, m, 0);
+  }
+
+  // Projections of consecutive dimensions, from the file and searched past it
+  auto extended = std::make_unique<QOLDSBuilder>(loaded);
+  extended->extendInitData(QOLDS_MAX_DIMENSIONS - 1, "");
+  extended->buildMatrices(QOLDS_MAX_DIMENSIONS - 1, QOLDS_SEQUENCE_LENGTH);
+  int    worstFile = 0, worstSearched = 0;
+  double sumFile = 0.0, sumSearched = 0.0;
+  for(int d = 0; d + 1 < extended->getDimensions(); d++)
+  {
+    const int pair[2] = {d, d + 1};
+    const int t       = extended->netQuality(pair, 2, QOLDS_SEQUENCE_LENGTH);
+    if(d + 1 < loaded.getInitDimensions())
+    {
+      worstFile = std::max(worstFile, t);
+      sumFile += t;
+    }
+    else
+    {
+      worstSearched = std::max(worstSearched, t);
+      sumSearched += t;
+    }
+  }
+
+  const int numFile = loaded.getInitDimensions() - 1;
+  std::printf("\nQOLDS nets (m=%d)\n", QOLDS_SEQUENCE_LENGTH);
+  std::printf("%-20s | (0,m,3)-net for m = 1 .. %d: %s\n", "Searched dims 1-3", QOLDS_SEQUENCE_LENGTH, success ? "yes" : "NO");
+  std::printf("%-20s | consecutive pairs: mean t %.2f, worst t %d\n", "File dims", sumFile / numFile, worstFile);
+  std::printf("%-20s | consecutive pairs: mean t %.2f, worst t %d (%d dimensions)\n", "Searched dims",
+              sumSearched / (extended->getDimensions() - 1 - numFile), worstSearched, extended->getDimensions() - loaded.getInitDimensions());
+  return success;
+}
+
+// Compile-time matrices against the runtime builder, for every number of digits
+bool checkBakedMatrices(const QOLDSBuilder& runtime, int dimensions)
+{
+  QOLDSBuilder baked;
+  for(int m = 1; m <= QOLDS_SEQUENCE_LENGTH; m++)
+  {
+    QOLDSBuilder reference = runtime;
+    reference.buildMatrices(dimensions, m);
+    baked.buildBakedMatrices(dimensions, m);
+    if(reference.getMatrixData() != baked.getMatrixData() || reference.getPackedMatrixData() != baked.getPackedMatrixData())
+    {
+      std::printf("[QOLDS] Error: baked matrices differ from the runtime builder (m=%d)\n", m);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Scrambled Sobol' points of two dimensions in every elementary interval of 2^m points: one per
+// interval of a (0,m,2)-net; the group of the dimensions is padded with its own index shuffle
+bool checkSobolNets(const SobolBuilder& sobol, int dimension, uint32_t pixelSeed, int maxDigits)
+{
+  for(int m = 1; m <= maxDigits; m++)
+  {
+    const uint32_t        numPoints = 1u << m;
+    std::vector<uint32_t> cells(numPoints);
+    for(int split = 0; split <= m; split++)
+    {
+      std::fill(cells.begin(), cells.end(), 0u);
+      for(uint32_t i = 0; i < numPoints; i++)
+      {
+        // First split bits of the first dimension, m - split bits of the second (exact: 24-bit values)
+        const uint32_t x = uint32_t(sobol.samplePoint(i, dimension, pixelSeed) * 16777216.0f) >> (24 - split);
+        const uint32_t y = uint32_t(sobol.samplePoint(i, dimension + 1, pixelSeed) * 16777216.0f) >> (24 - (m - split));
+        cells[(x << (m - split)) | y]++;
+      }
+      if(std::any_of(cells.begin(), cells.end(), [](uint32_t n) { return n != 1u; }))
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if(argc < 2)
+  {
+    std::printf("Usage: %s <initIrreducibleGF3.dat> [digits=5] [samples=1000000]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const int      digits     = (argc > 2) ? std::atoi(argv[2]) : 5;
+  const uint32_t samples    = (argc > 3) ? uint32_t(std::strtoul(argv[3], nullptr, 10)) : 1000000u;
+  const int      dimensions = 47;
+
+  QOLDSBuilder builder;
+  if(!builder.loadInitData(argv[1]))
+    return EXIT_FAILURE;
+  const bool checksOk = checkBakedMatrices(builder, dimensions) && benchBuilder(builder, dimensions, digits) && checkNets(builder);
+
+  builder.buildMatrices(dimensions, digits);
+  builder.generateScrambleSeeds(12345u);
+
+  const uint32_t  numPoints = uint32_t(builder.getMaxPoints());
+  const uint32_t* table     = nullptr;
+  bool            success   = checksOk;
+
+  std::printf("\nQOLDS evaluation cost (%d dimensions, 3^%d points, %u samples)\n", dimensions, digits, samples);
+  std::printf("%-20s | %12s\n", "Mode", "ns/sample");
+
+  BenchResult analytic = runBenchmark(dimensions, samples, [&](uint32_t i, int d) { return builder.samplePoint(i, d); });
+  std::printf("%-20s | %12.2f\n", "Analytic", analytic.nsPerSample);
+
+  BenchResult packed = runBenchmark(dimensions, samples, [&](uint32_t i, int d) { return builder.samplePointPacked(i, d); });
+  bool packedOps  = checkPackedArithmetic();
+  int  mismatches = countPackedMismatches(builder);
+  std::printf("%-20s | %12.2f  (%.1fx, %s, %d mismatching points)\n", "Analytic (packed)", packed.nsPerSample,
+              analytic.nsPerSample / packed.nsPerSample, packedOps ? "arithmetic ok" : "arithmetic FAILED", mismatches);
+  std::printf("%-20s   matrices %zu bytes -> %zu bytes\n", "", builder.getMatrixData().size() * sizeof(int32_t),
+              builder.getPackedMatrixData().size() * sizeof(uint32_t));
+  success &= packedOps && (mismatches == 0);
+
+  success &= benchStream(builder, std::max(samples / uint32_t(dimensions), 1u));
+
+  builder.buildPointTable(QOLDSBuilder::TableFormat::eFloat32);
+  table = builder.getPointTableData().data();
+  BenchResult tableF = runBenchmark(dimensions, samples, [&](uint32_t i, int d) { return tableFloat(table, numPoints, i, d); });
+  float       errorF = maxTableError(builder, [&](uint32_t i, int d) { return tableFloat(table, numPoints, i, d); });
+  std::printf("%-20s | %12.2f  (%.1fx, max error %g)\n", "Table (float32)", tableF.nsPerSample,
+              analytic.nsPerSample / tableF.nsPerSample, errorF);
+  success &= (errorF == 0.0f);
+
+  builder.buildPointTable(QOLDSBuilder::TableFormat::eUnorm16);
+  table = builder.getPointTableData().data();
+  BenchResult tableU = runBenchmark(dimensions, samples, [&](uint32_t i, int d) { return tableUnorm16(table, numPoints, i, d); });
+  float       errorU = maxTableError(builder, [&](uint32_t i, int d) { return tableUnorm16(table, numPoints, i, d); });
+  std::printf("%-20s | %12.2f  (%.1fx, max error %g)\n", "Table (unorm16)", tableU.nsPerSample,
+              analytic.nsPerSample / tableU.nsPerSample, errorU);
+  success &= (errorU <= 1.0f / 65536.0f);
+
+  SobolBuilder sobol;
+  sobol.buildMatrices();
+  sobol.generateScrambleSeed(12345u);
+  const uint32_t sobolPixelSeed = sobol.pixelSeed(3, 5);
+  BenchResult    sobolOwen =
+      runBenchmark(dimensions, samples, [&](uint32_t i, int d) { return sobol.samplePoint(i, d, sobolPixelSeed); });
+  const bool sobolNets = checkSobolNets(sobol, 0, sobolPixelSeed, 16) && checkSobolNets(sobol, SOBOL_MAX_DIMENSIONS, sobolPixelSeed, 16);
+  std::printf("%-20s | %12.2f  (%.1fx, 2^m points, (0,m,2)-nets for m = 1 .. 16: %s)\n", "Sobol' (Owen)",
+              sobolOwen.nsPerSample, analytic.nsPerSample / sobolOwen.nsPerSample, sobolNets ? "yes" : "NO");
+  success &= sobolNets;
+
+  if(!success)
+    std::printf("\n[QOLDS] Error: packed sampler or point table does not match the analytic points, or a net check failed\n");
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Sampler convergence benchmark
+
+    Integrates analytic integrands with a known value using the samplers of
+    the path tracer, and reports for every sampler, dimension count and
+    sample count the RMSE, the convergence slope and the cost per sample:
+    - PCG:            rand() of the shaders
+    - QOLDS:          the host-side generator (QOLDSBuilder::samplePoint)
+    - QOLDS (shader): the CPU port of qolds_sample() (samplePointPacked),
+                      same points, cost of the packed-trit arithmetic
+    - Sobol' (Owen):  the CPU reference of sobol_owen_sample()
+
+    Integrands, over s dimensions:
+    - smooth:         prod(1 + sin(2 pi u_k + phase_k) / 2), value 1
+    - discontinuous:  sum(u_k) < s / 2, a diagonal edge, value 1/2
+    - heaviside:      prod(u_k < c) with c^s = 1/2, an axis-aligned corner
+    - ggx:            white-furnace albedo of single-scattering GGX (alpha 0.5,
+                      view at 60 degrees), cosine-sampled on the last two dims
+    - ggx+msx:        the same with the Fast-MSX term of fast_msx.h.slang
+    The GGX values are integrals of the estimator over the unit square,
+    computed once by a 2048^2 midpoint rule.
+
+    The RMSE is over replicates that are the pixels of the renderer: each
+    replicate uses the per-pixel decorrelation of the GPU (pixel seed).
+    The samplers are sequences, so every replicate runs the largest count
+    once and reads the smaller counts from the running sums; QOLDS checks
+    powers of 3, the base-2 samplers powers of 2. The slope is the least
+    squares fit of log(RMSE) against log(samples): -0.5 for Monte Carlo.
+    ns/sample is one 1D value, timed on one thread.
+
+    The full results go to a JSON file, the console gets the slopes.
+
+    Usage: qolds_convergence <initIrreducibleGF3.dat> [digits=9] [replicates=32] [output=qolds_convergence.json]
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <nvutils/parallel_work.hpp>
+
+#include "qolds_builder.hpp"
+#include "sobol_builder.hpp"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Dimension counts of the s-dimensional integrands (camera, one bounce, two bounces, deep path)
+constexpr int kDimensionCounts[] = {2, 4, 8, 16};
+
+// PCG of rand() in the shaders (nvshaders/random.h.slang)
+uint32_t pcg(uint32_t& state)
+{
+  uint32_t prev = state * 747796405u + 2891336453u;
+  uint32_t word = ((prev >> ((prev >> 28u) + 4u)) ^ prev) * 277803737u;
+  state         = prev;
+  return (word >> 22u) ^ word;
+}
+
+//--------------------------------------------------------------------------------------------------
+// GGX integrands: isotropic GGX with F = 1, so the integral is the directional albedo
+//
+constexpr double kGgxAlpha     = 0.5;
+constexpr double kGgxViewTheta = kPi / 3.0;
+
+struct Vec3
+{
+  double x, y, z;
+};
+
+Vec3 normalize(Vec3 v)
+{
+  const double len = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+  return {v.x / len, v.y / len, v.z / len};
+}
+
+double dot(Vec3 a, Vec3 b)
+{
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Height-correlated Smith Lambda
+double smithLambda(double cosTheta)
+{
+  const double tan2 = (1.0 - cosTheta * cosTheta) / (cosTheta * cosTheta);
+  return 0.5 * (-1.0 + std::sqrt(1.0 + kGgxAlpha * kGgxAlpha * tan2));
+}
+
+// Single-scattering GGX BRDF
+double ggxBrdf(Vec3 v, Vec3 l)
+{
+  const Vec3   h   = normalize({v.x + l.x, v.y + l.y, v.z + l.z});
+  const double a2  = kGgxAlpha * kGgxAlpha;
+  const double c2  = h.z * h.z;
+  const double den = c2 * (a2 - 1.0) + 1.0;
+  const double d   = a2 / (kPi * den * den);
+  const double g2  = 1.0 / (1.0 + smithLambda(v.z) + smithLambda(l.z));
+  return d * g2 / (4.0 * v.z * l.z);
+}
+
+// compute_fast_msx() of fast_msx.h.slang with F0 = 1
+double fastMsx(Vec3 v, Vec3 l)
+{
+  const Vec3   n       = {0.0, 0.0, 1.0};
+  const Vec3   h       = normalize({v.x + l.x, v.y + l.y, v.z + l.z});
+  const Vec3   c       = normalize({h.x + n.x, h.y + n.y, h.z + n.z});
+  const double cDotV   = std::max(dot(c, v), 0.0);
+  const double thetaVc = std::acos(cDotV);
+  const double thetaVl = std::acos(std::clamp(dot(v, l), 0.0, 1.0));
+  const double thetaM  = (kPi - thetaVl) * 0.25;
+
+  const double op = std::sin(thetaVc - thetaM) / std::sin(thetaVc + thetaM);
+  const double gI = 1.0 - std::max(0.0, op);
+
+  const double a2    = kGgxAlpha * kGgxAlpha;
+  const double cosM2 = std::cos(thetaM) * std::cos(thetaM);
+  const double den   = cosM2 * (a2 - 1.0) + 1.0;
+  const double dI    = (a2 / kPi) / (den * den);
+
+  if(cDotV < 0.0001)
+    return 0.0;
+  return dI * gI / (2.0 * cDotV);
+}
+
+// Estimator of the albedo with a cosine-sampled light direction: f * cos / pdf = pi * f
+double ggxEstimate(double u0, double u1, bool withMsx)
+{
+  const Vec3   v   = {std::sin(kGgxViewTheta), 0.0, std::cos(kGgxViewTheta)};
+  const double r   = std::sqrt(u0);
+  const double phi = 2.0 * kPi * u1;
+  const Vec3   l   = {r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(1.0 - u0, 1e-12))};
+
+  double f = ggxBrdf(v, l);
+  if(withMsx)
+    f += fastMsx(v, l);
+  return kPi * f;
+}
+
+// Integral of the estimator over the unit square, by the midpoint rule
+double ggxReference(bool withMsx)
+{
+  constexpr uint32_t  kCells = 2048;
+  std::vector<double> rows(kCells);
+  nvutils::parallel_batches<1>(uint64_t(kCells), [&](uint64_t y) {
+    double sum = 0.0;
+    for(uint32_t x = 0; x < kCells; x++)
+      sum += ggxEstimate((double(x) + 0.5) / kCells, (double(y) + 0.5) / kCells, withMsx);
+    rows[y] = sum;
+  });
+
+  double sum = 0.0;
+  for(double row : rows)
+    sum += row;
+  return sum / (double(kCells) * double(kCells));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Integrands
+//
+struct Integrand
+{
+  const char* name;
+  double (*f)(const double* u, int s);
+  double reference;  // Independent of s
+};
+
+double smooth(const double* u, int s)
+{
+  double value = 1.0;
+  for(int k = 0; k < s; k++)
+    value *= 1.0 + 0.5 * std::sin(2.0 * kPi * u[k] + 0.37 * k);
+  return value;
+}
+
+double discontinuous(const double* u, int s)
+{
+  double sum = 0.0;
+  for(int k = 0; k < s; k++)
+    sum += u[k];
+  return (sum < 0.5 * s) ? 1.0 : 0.0;
+}
+
+double heaviside(const double* u, int s)
+{
+  const double c = std::pow(0.5, 1.0 / s);
+  for(int k = 0; k < s; k++)
+  {
+    if(u[k] >= c)
+      return 0.0;
+  }
+  return 1.0;
+}
+
+double ggx(const double* u, int s)
+{
+  return ggxEstimate(u[s - 2], u[s - 1], false);
+}
+
+double ggxMsx(const double* u, int s)
+{
+  return ggxEstimate(u[s - 2], u[s - 1], true);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Samplers: value of a dimension of a sample, for a replicate (pixel)
+//
+enum Sampler
+{
+  ePcg,
+  eQolds,
+  eQoldsShader,
+  eSobolOwen,
+  eNumSamplers
+};
+
+const char* kSamplerNames[eNumSamplers] = {"PCG", "QOLDS", "QOLDS (shader)", "Sobol' (Owen)"};
+
+struct Samplers
+{
+  QOLDSBuilder qolds;
+  SobolBuilder sobol;
+
+  // Number base of the sample counts where the sampler is balanced
+  static uint32_t base(Sampler sampler) { return (sampler == eQolds || sampler == eQoldsShader) ? 3u : 2u; }
+
+  // Seed of a replicate: pixel (replicate, 0) of the renderer
+  uint32_t replicateSeed(Sampler sampler, uint32_t replicate) const
+  {
+    switch(sampler)
+    {
+      case eQolds:
+      case eQoldsShader:
+        return QOLDSBuilder::pixelSeed(replicate, 0);
+      case eSobolOwen:
+        return sobol.pixelSeed(replicate, 0);
+      default:
+        return replicate;
+    }
+  }
+
+  float sample(Sampler sampler, uint32_t index, int dimension, uint32_t seed) const
+  {
+    switch(sampler)
+    {
+      case eQolds:
+        return qolds.samplePoint(index, dimension, seed);
+      case eQoldsShader:
+        return qolds.samplePointPacked(index, dimension, seed);
+      case eSobolOwen:
+        return sobol.samplePoint(index, dimension, seed);
+      default:
+      {
+        uint32_t state = seed * 0x9e3779b1u ^ index * 0x85ebca77u ^ uint32_t(dimension) * 0xc2b2ae3du;
+        pcg(state);
+        return float(pcg(state)) * (1.0f / 4294967296.0f);
+      }
+    }
+  }
+};
+
+struct Series
+{
+  Sampler               sampler;
+  int                   dimensions;
+  const Integrand*      integrand;
+  double                nsPerSample;
+  std::vector<uint32_t> counts;
+  std::vector<double>   rmse;
+  double                slope;
+};
+
+// Keeps the timed loop from being optimized out
+volatile float g_sink = 0.0f;
+
+// Least squares slope of log(rmse) against log(count)
+double fitSlope(const std::vector<uint32_t>& counts, const std::vector<double>& rmse)
+{
+  double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+  int    n  = 0;
+  for(size_t i = 0; i < counts.size(); i++)
+  {
+    if(rmse[i] <= 0.0)
+      continue;
+    const double x = std::log(double(counts[i]));
+    const double y = std::log(rmse[i]);
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+    n++;
+  }
+  const double den = n * sxx - sx * sx;
+  return (n > 1 && den != 0.0) ? (n * sxy - sx * sy) / den : 0.0;
+}
+
+// Cost of one 1D value, on one thread
+double timeSampler(const Samplers& samplers, Sampler sampler, uint32_t numSamples, int dimensions)
+{
+  const uint32_t seed  = samplers.replicateSeed(sampler, 0);
+  auto           start = std::chrono::high_resolution_clock::now();
+  float          sum   = 0.0f;
+  for(uint32_t i = 0; i < numSamples; i++)
+    for(int d = 0; d < dimensions; d++)
+      sum += samplers.sample(sampler, i, d, seed);
+  auto end = std::chrono::high_resolution_clock::now();
+
+  g_sink = sum;
+  return std::chrono::duration<double, std::nano>(end - start).count() / (double(numSamples) * dimensions);
+}
+
+// All integrands of a sampler and dimension count: every replicate runs maxSamples once, in parallel
+void runSeries(const Samplers& samplers, Sampler sampler, int dimensions, const std::vector<Integrand>& integrands,
+               uint32_t maxSamples, uint32_t replicates, std::vector<Series>& results)
+{
+  std::vector<uint32_t> counts;
+  for(uint32_t n = 1; n <= maxSamples; n *= Samplers::base(sampler))
+    counts.push_back(n);
+
+  const size_t        numIntegrands = integrands.size();
+  const size_t        numCounts     = counts.size();
+  std::vector<double> squaredErrors(size_t(replicates) * numIntegrands * numCounts, 0.0);
+
+  nvutils::parallel_batches<1>(uint64_t(replicates), [&](uint64_t r) {
+    const uint32_t      seed = samplers.replicateSeed(sampler, uint32_t(r));
+    std::vector<double> sums(numIntegrands, 0.0);
+    double              u[kDimensionCounts[std::size(kDimensionCounts) - 1]];
+    size_t              next = 0;
+    for(uint32_t i = 0; i < counts.back(); i++)
+    {
+      for(int d = 0; d < dimensions; d++)
+        u[d] = samplers.sample(sampler, i, d, seed);
+      for(size_t k = 0; k < numIntegrands; k++)
+        sums[k] += integrands[k].f(u, dimensions);
+
+      if(i + 1 == counts[next])
+      {
+        for(size_t k = 0; k < numIntegrands; k++)
+        {
+          const double error = sums[k] / double(i + 1) - integrands[k].reference;
+          squaredErrors[(r * numIntegrands + k) * numCounts + next] = error * error;
+        }
+        next++;
+      }
+    }
+  });
+
+  const double nsPerSample = timeSampler(samplers, sampler, counts.back(), dimensions);
+  for(size_t k = 0; k < numIntegrands; k++)
+  {
+    Series series{sampler, dimensions, &integrands[k], nsPerSample, counts, std::vector<double>(numCounts, 0.0), 0.0};
+    for(size_t c = 0; c < numCounts; c++)
+    {
+      double sum = 0.0;
+      for(uint32_t r = 0; r < replicates; r++)
+        sum += squaredErrors[(r * numIntegrands + k) * numCounts + c];
+      series.rmse[c] = std::sqrt(sum / replicates);
+    }
+    series.slope = fitSlope(series.counts, series.rmse);
+    results.push_back(std::move(series));
+  }
+}
+
+bool writeJson(const std::string& path, const std::vector<Series>& results, int digits, uint32_t replicates)
+{
+  FILE* file = std::fopen(path.c_str(), "w");
+  if(!file)
+  {
+    std::printf("[QOLDS] Error: cannot write %s\n", path.c_str());
+    return false;
+  }
+
+  std::fprintf(file, "{\n  \"digits\": %d,\n  \"replicates\": %u,\n  \"results\": [\n", digits, replicates);
+  for(size_t i = 0; i < results.size(); i++)
+  {
+    const Series& s = results[i];
+    std::fprintf(file,
+                 "    {\"sampler\": \"%s\", \"dimensions\": %d, \"integrand\": \"%s\", \"reference\": %.17g, "
+                 "\"ns_per_sample\": %.3f, \"slope\": %.4f,\n     \"samples\": [",
+                 kSamplerNames[s.sampler], s.dimensions, s.integrand->name, s.integrand->reference, s.nsPerSample, s.slope);
+    for(size_t c = 0; c < s.counts.size(); c++)
+      std::fprintf(file, "%s{\"n\": %u, \"rmse\": %.6e}", c ? ", " : "", s.counts[c], s.rmse[c]);
+    std::fprintf(file, "]}%s\n", (i + 1 < results.size()) ? "," : "");
+  }
+  std::fprintf(file, "  ]\n}\n");
+  std::fclose(file);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if(argc < 2)
+  {
+    std::printf("Usage: %s <initIrreducibleGF3.dat> [digits=9] [replicates=32] [output=qolds_convergence.json]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const int         digits     = (argc > 2) ? std::atoi(argv[2]) : 9;
+  const uint32_t    replicates = (argc > 3) ? uint32_t(std::atoi(argv[3])) : 32u;
+  const std::string output     = (argc > 4) ? argv[4] : "qolds_convergence.json";
+  const int         maxDims    = kDimensionCounts[std::size(kDimensionCounts) - 1];
+
+  Samplers samplers;
+  if(!samplers.qolds.loadInitData(argv[1]))
+    return EXIT_FAILURE;
+  samplers.qolds.buildMatrices(maxDims, digits);
+  samplers.qolds.generateScrambleSeeds(12345u);
+  samplers.sobol.buildMatrices();
+  samplers.sobol.generateScrambleSeed(12345u);
+
+  const std::vector<Integrand> integrands = {
+      {"smooth", smooth, 1.0},
+      {"discontinuous", discontinuous, 0.5},
+      {"heaviside", heaviside, 0.5},
+      {"ggx", ggx, ggxReference(false)},
+      {"ggx+msx", ggxMsx, ggxReference(true)},
+  };
+
+  // The same budget for every sampler: the 3^m points of the QOLDS net
+  const uint32_t maxSamples = uint32_t(samplers.qolds.getMaxPoints());
+
+  std::vector<Series> results;
+  for(int s = 0; s < eNumSamplers; s++)
+    for(int dimensions : kDimensionCounts)
+      runSeries(samplers, Sampler(s), dimensions, integrands, maxSamples, replicates, results);
+
+  // Console summary: slope per integrand and dimension count, and the cost
+  std::printf("\nConvergence slope (RMSE ~ samples^slope, %u replicates, up to %u samples)\n", replicates, maxSamples);
+  std::printf("%-15s %4s | %9s", "Sampler", "dims", "ns/sample");
+  for(const Integrand& integrand : integrands)
+    std::printf(" | %13s", integrand.name);
+  std::printf("\n");
+  for(size_t i = 0; i < results.size(); i += integrands.size())
+  {
+    std::printf("%-15s %4d | %9.2f", kSamplerNames[results[i].sampler], results[i].dimensions, results[i].nsPerSample);
+    for(size_t k = 0; k < integrands.size(); k++)
+      std::printf(" | %6.2f %6.1e", results[i + k].slope, results[i + k].rmse.back());
+    std::printf("\n");
+  }
+  std::printf("(slope, and RMSE at the largest count)\n");
+
+  if(!writeJson(output, results, digits, replicates))
+    return EXIT_FAILURE;
+  std::printf("Results written to %s\n", output.c_str());
+  return EXIT_SUCCESS;
+}
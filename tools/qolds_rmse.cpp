@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2025, MatForge Team (CIS 5650, University of Pennsylvania)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, MatForge Team
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    QOLDS RMSE harness
+
+    Integrates a small "image" on the CPU, every pixel estimating an integral
+    with a known value, and reports the error against the number of samples
+    per pixel for:
+    - PCG:            the pseudo-random sampler of the path tracer (rand())
+    - QOLDS shared:   the same QOLDS point in every pixel (no decorrelation)
+    - QOLDS Owen/px:  per-pixel Owen scrambling (analytic mode)
+    - QOLDS rot/px:   per-pixel rotation of the point table (table mode)
+    - Sobol' Owen/px: base-2 Sobol' with per-pixel hash-based Owen scrambling
+                      (SobolBuilder, the SamplerType::eSamplerSobolOwen backend)
+
+    The integrands vary smoothly over the image, like a flat or slowly varying
+    region of a render. RMSE is over the pixels; "mean err" is the error of the
+    image average, which stays high when the per-pixel errors are correlated
+    (the screen-space structure of a shared sequence).
+
+    The sample counts run two powers of 3 past the 3^m points of the net, into
+    the independently scrambled epochs (QOLDSBuilder::epochSeed()), which must
+    keep converging instead of repeating the first epoch. The counts are
+    powers of 3, which favor QOLDS: Sobol' nets are balanced at powers of 2.
+
+    Usage: qolds_rmse <initIrreducibleGF3.dat> [digits=5] [resolution=64]
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "qolds_builder.hpp"
+#include "sobol_builder.hpp"
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+// PCG of rand() in the shaders (nvshaders/random.h.slang)
+uint32_t pcg(uint32_t& state)
+{
+  uint32_t prev = state * 747796405u + 2891336453u;
+  uint32_t word = ((prev >> ((prev >> 28u) + 4u)) ^ prev) * 277803737u;
+  state         = prev;
+  return (word >> 22u) ^ word;
+}
+
+float randPcg(uint32_t& seed)
+{
+  return float(pcg(seed)) * (1.0f / float(0xffffffffu));
+}
+
+// Per-pixel seed of a sample, like xxhash32(uint3(pixel, frame)) in processPixel
+uint32_t pixelSampleSeed(uint32_t x, uint32_t y, uint32_t s)
+{
+  uint32_t h = x * 0x9e3779b1u ^ y * 0x85ebca77u ^ s * 0xc2b2ae3du;
+  return pcg(h);
+}
+
+float wrap(float x)
+{
+  return x - std::floor(x);
+}
+
+// Test integrand: point u (4D) and per-pixel offsets, returns the value; integral is exact
+struct Integrand
+{
+  const char*                                               name;
+  std::function<float(const float* u, float ox, float oy)> f;
+  float                                                     reference;
+};
+
+const Integrand kIntegrands[] = {
+    // Smooth product, like a glossy lobe times smooth lighting
+    {"smooth 4D",
+     [](const float* u, float ox, float oy) {
+       return (1.0f + 0.5f * std::sin(2.0f * kPi * (u[0] + ox))) * (1.0f + 0.5f * std::sin(2.0f * kPi * (u[1] + oy)))
+              * (1.0f + 0.5f * std::sin(2.0f * kPi * u[2])) * (1.0f + 0.5f * std::sin(2.0f * kPi * u[3]));
+     },
+     1.0f},
+    // Disk indicator, like the visibility of an area light
+    {"disk 2D",
+     [](const float* u, float ox, float oy) {
+       float dx = wrap(u[0] + ox) - 0.5f;
+       float dy = wrap(u[1] + oy) - 0.5f;
+       return (dx * dx + dy * dy < 0.16f) ? 1.0f : 0.0f;
+     },
+     kPi * 0.16f},
+};
+
+enum Sampler
+{
+  ePcg,
+  eQoldsShared,
+  eQoldsOwenPerPixel,
+  eQoldsRotatePerPixel,
+  eSobolOwenPerPixel,
+  eNumSamplers
+};
+
+const char* kSamplerNames[eNumSamplers] = {"PCG", "QOLDS shared", "QOLDS Owen/px", "QOLDS rot/px", "Sobol' Owen/px"};
+
+struct ErrorStats
+{
+  double rmse{0.0};
+  double meanError{0.0};
+};
+
+ErrorStats measure(const QOLDSBuilder& builder, const SobolBuilder& sobol, const Integrand& integrand, Sampler sampler,
+                   uint32_t spp, uint32_t resolution)
+{
+  double sumSq   = 0.0;
+  double sumDiff = 0.0;
+  for(uint32_t y = 0; y < resolution; y++)
+  {
+    for(uint32_t x = 0; x < resolution; x++)
+    {
+      const float    ox        = float(x) / float(resolution);
+      const float    oy        = float(y) / float(resolution);
+      const uint32_t pixelSeed = QOLDSBuilder::pixelSeed(x, y);
+      const uint32_t sobolSeed = sobol.pixelSeed(x, y);
+
+      double sum = 0.0;
+      for(uint32_t s = 0; s < spp; s++)
+      {
+        float    u[4];
+        uint32_t seed = pixelSampleSeed(x, y, s);
+        for(int d = 0; d < 4; d++)
+        {
+          switch(sampler)
+          {
+            case ePcg:
+              u[d] = randPcg(seed);
+              break;
+            case eQoldsShared:
+              u[d] = builder.samplePoint(s, d);
+              break;
+            case eQoldsOwenPerPixel:
+              u[d] = builder.samplePoint(s, d, pixelSeed);
+              break;
+            case eSobolOwenPerPixel:
+              u[d] = sobol.samplePoint(s, d, sobolSeed);
+              break;
+            default:
+            {
+              // Table lookup of the point in its epoch, as qolds_sample_table()
+              const uint32_t numPoints = uint32_t(builder.getMaxPoints());
+              const uint32_t epoch     = s / numPoints;
+              u[d] = QOLDSBuilder::rotatePoint(builder.samplePoint(s - epoch * numPoints, d), d,
+                                               QOLDSBuilder::epochSeed(pixelSeed, epoch));
+              break;
+            }
+          }
+        }
+        sum += integrand.f(u, ox, oy);
+      }
+
+      double diff = sum / double(spp) - double(integrand.reference);
+      sumSq += diff * diff;
+      sumDiff += diff;
+    }
+  }
+
+  const double numPixels = double(resolution) * double(resolution);
+  return {std::sqrt(sumSq / numPixels), std::abs(sumDiff / numPixels)};
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if(argc < 2)
+  {
+    std::printf("Usage: %s <initIrreducibleGF3.dat> [digits=5] [resolution=64]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const int      digits     = (argc > 2) ? std::atoi(argv[2]) : 5;
+  const uint32_t resolution = (argc > 3) ? uint32_t(std::atoi(argv[3])) : 64u;
+
+  QOLDSBuilder builder;
+  if(!builder.loadInitData(argv[1]))
+    return EXIT_FAILURE;
+  builder.buildMatrices(4, digits);
+  builder.generateScrambleSeeds(12345u);
+
+  SobolBuilder sobol;
+  sobol.buildMatrices();
+  sobol.generateScrambleSeed(12345u);
+
+  for(const Integrand& integrand : kIntegrands)
+  {
+    std::printf("\n%s, %ux%u pixels\n", integrand.name, resolution, resolution);
+    std::printf("%6s", "spp");
+    for(const char* name : kSamplerNames)
+      std::printf(" | %-22s", name);
+    std::printf("\n%6s", "");
+    for(int i = 0; i < eNumSamplers; i++)
+      std::printf(" | %10s %11s", "rmse", "mean err");
+    std::printf("\n");
+
+    // Powers of 3, where the sequence is best stratified, up to two epochs past the net
+    std::vector<double> firstRmse(eNumSamplers, 0.0), lastRmse(eNumSamplers, 0.0);
+    uint32_t            lastSpp = 1;
+    for(uint32_t spp = 1; spp <= 9u * uint32_t(builder.getMaxPoints()); spp *= 3)
+    {
+      if(spp == 3u * uint32_t(builder.getMaxPoints()))
+        std::printf("%6s   (past 3^%d: scrambled epochs)\n", "", builder.getDigits());
+      std::printf("%6u", spp);
+      for(int i = 0; i < eNumSamplers; i++)
+      {
+        ErrorStats stats = measure(builder, sobol, integrand, Sampler(i), spp, resolution);
+        std::printf(" | %10.3e %11.3e", stats.rmse, stats.meanError);
+        if(spp == 1)
+          firstRmse[i] = stats.rmse;
+        lastRmse[i] = stats.rmse;
+      }
+      std::printf("\n");
+      lastSpp = spp;
+    }
+
+    // Convergence rate: RMSE ~ spp^slope (-0.5 for Monte Carlo)
+    std::printf("%6s", "slope");
+    for(int i = 0; i < eNumSamplers; i++)
+    {
+      double slope = (lastSpp > 1 && firstRmse[i] > 0.0 && lastRmse[i] > 0.0) ?
+                         std::log(lastRmse[i] / firstRmse[i]) / std::log(double(lastSpp)) :
+                         0.0;
+      std::printf(" | %10.2f %11s", slope, "");
+    }
+    std::printf("\n");
+  }
+
+  return EXIT_SUCCESS;
+}